@@ -25,6 +25,46 @@
     inline int platform_kbhit() { return _kbhit(); }
     inline int platform_getch() { return _getch(); }
 
+    // Read-only file mapping
+    struct MappedFile {
+        const void* data;
+        size_t size;
+        HANDLE file;
+        HANDLE mapping;
+    };
+
+    inline bool platform_map_file(const char* path, MappedFile* out) {
+        out->data = nullptr; out->size = 0;
+        out->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (out->file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(out->file, &size) || size.QuadPart == 0) {
+            CloseHandle(out->file);
+            return false;
+        }
+        out->mapping = CreateFileMappingA(out->file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!out->mapping) {
+            CloseHandle(out->file);
+            return false;
+        }
+        out->data = MapViewOfFile(out->mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!out->data) {
+            CloseHandle(out->mapping);
+            CloseHandle(out->file);
+            return false;
+        }
+        out->size = (size_t)size.QuadPart;
+        return true;
+    }
+
+    inline void platform_unmap_file(MappedFile* f) {
+        if (!f->data) return;
+        UnmapViewOfFile(f->data);
+        CloseHandle(f->mapping);
+        CloseHandle(f->file);
+        f->data = nullptr; f->size = 0;
+    }
+
 #else
     #define WINLIN(windows, linux) linux
     #include <dlfcn.h>
@@ -32,6 +72,8 @@
     #include <termios.h>
     #include <fcntl.h>
     #include <sys/select.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
     #include <stdio.h>
 
     // Types
@@ -65,6 +107,35 @@
         }
     }
 
+    // Read-only file mapping
+    struct MappedFile {
+        const void* data;
+        size_t size;
+    };
+
+    inline bool platform_map_file(const char* path, MappedFile* out) {
+        out->data = nullptr; out->size = 0;
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            return false;
+        }
+        void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) return false;
+        out->data = p;
+        out->size = (size_t)st.st_size;
+        return true;
+    }
+
+    inline void platform_unmap_file(MappedFile* f) {
+        if (!f->data) return;
+        munmap((void*)f->data, f->size);
+        f->data = nullptr; f->size = 0;
+    }
+
     // This allows reading chars without hitting enter
     struct TermSetup {
         struct termios oldt;
@@ -79,8 +150,9 @@
         }
     };
     
-    // Global static to ensure terminal resets on exit
-    static TermSetup _term_setup; 
+    // Global to ensure terminal resets on exit, inline so every translation
+    // unit including this header shares the one instance
+    inline TermSetup _term_setup;
 
 #endif
 
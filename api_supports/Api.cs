@@ -6,6 +6,8 @@ using System.Runtime.InteropServices;
 public static class PluginConstants
 {
     public const uint ABI_V1 = 1;
+    public const uint ABI_V2 = 2;
+    public const uint ABI_CURRENT = ABI_V2;
 
     public const sbyte PRIORITY_DEFAULT = 1;
     public const sbyte PRIORITY_FIRST = 0;
@@ -13,6 +15,36 @@ public static class PluginConstants
 
     public const byte DEP_TYPE_REQUIRED = 0;
     public const byte DEP_TYPE_OPTIONAL = 1;
+
+    public const byte DESC_DEPENDENCY = 0;
+    public const byte DESC_CAPABILITY = 1;
+
+    public const ulong PLUGIN_FEATURE_THREAD_SAFE = 1ul << 0;
+
+    public const ulong HOST_FEATURE_BATCH = 1ul << 0;
+    public const ulong HOST_FEATURE_TYPED_EVENTS = 1ul << 1;
+    public const ulong HOST_FEATURE_WATCH = 1ul << 2;
+    public const ulong HOST_FEATURE_TYPED_DATA = 1ul << 3;
+    public const ulong HOST_FEATURE_MEMORY = 1ul << 4;
+    public const ulong HOST_FEATURE_CLOCK = 1ul << 5;
+    public const ulong HOST_FEATURE_EVENT_POLICY = 1ul << 6;
+    public const ulong HOST_FEATURE_METRICS = 1ul << 7;
+    public const ulong HOST_FEATURE_USERDATA = 1ul << 8;
+
+    public const uint EVENT_POLICY_IMMEDIATE = 0;
+    public const uint EVENT_POLICY_LATEST = 1;
+    public const uint EVENT_POLICY_KEYED = 2;
+    public const uint EVENT_POLICY_DEBOUNCE = 3;
+    public const uint EVENT_POLICY_THROTTLE = 4;
+
+    public const uint METRIC_COUNTER = 0;
+    public const uint METRIC_GAUGE = 1;
+
+    public const uint DATA_NONE = 0;
+    public const uint DATA_STRING = 1;
+    public const uint DATA_INT64 = 2;
+    public const uint DATA_DOUBLE = 3;
+    public const uint DATA_BYTES = 4;
 }
 
 [StructLayout(LayoutKind.Sequential)]
@@ -33,8 +65,66 @@ public unsafe struct PluginInfo
     public fixed Dependency dependencies[128];
 }
 
+[StructLayout(LayoutKind.Sequential)]
+public unsafe struct PluginDescriptor
+{
+    public sbyte* name;
+    public byte kind;
+    public byte type;
+}
+
+// ABI v2, shares its first fields with PluginInfo
+[StructLayout(LayoutKind.Sequential)]
+public unsafe struct PluginInfoV2
+{
+    public sbyte* name;
+    public sbyte* version;
+    public uint abi_version;
+    public sbyte priority;
+    private fixed byte _pad[3];
+    public uint descriptor_count;
+    public PluginDescriptor* descriptors;
+    public ulong features;
+    public uint host_table_size;
+}
+
+// Batched call elements, passed to the host as contiguous arrays
+[StructLayout(LayoutKind.Sequential)]
+public unsafe struct HostEvent
+{
+    public sbyte* name;
+    public sbyte* payload;
+}
+
+[StructLayout(LayoutKind.Sequential)]
+public unsafe struct HostKeyValue
+{
+    public sbyte* key;
+    public sbyte* value; // Filled in by get_data_many, null when missing
+}
+
+[StructLayout(LayoutKind.Sequential)]
+public unsafe struct HostHandler
+{
+    public sbyte* eventName;
+    public delegate* unmanaged[Cdecl]<sbyte*, sbyte*, void> callback;
+}
+
+// Typed storage value, only the field matching type is used
+[StructLayout(LayoutKind.Sequential)]
+public unsafe struct DataValue
+{
+    public uint type;
+    public uint size;
+    public long i;
+    public double d;
+    public void* data;
+}
+
 [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
 public unsafe delegate void EventCallback(sbyte* eventName, sbyte* payload);
+[UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+public unsafe delegate void TypedCallback(sbyte* eventName, void* data, uint size);
 
 [StructLayout(LayoutKind.Sequential)]
 public unsafe struct PluginHost
@@ -55,12 +145,96 @@ public unsafe struct PluginHost
 
     public delegate* unmanaged[Cdecl]<uint, EventCallback, bool, ulong> set_timer;
     public delegate* unmanaged[Cdecl]<ulong, bool> cancel_timer;
+
+    // ABI v2, entries below are only valid when table_size covers them
+    public uint abi_version;
+    public uint table_size;
+    public ulong features;
+
+    // HOST_FEATURE_BATCH
+    public delegate* unmanaged[Cdecl]<HostEvent*, uint, void> send_events;
+    public delegate* unmanaged[Cdecl]<HostKeyValue*, uint, uint> set_data_many;
+    public delegate* unmanaged[Cdecl]<HostKeyValue*, uint, uint> get_data_many;
+    public delegate* unmanaged[Cdecl]<HostHandler*, uint, void> register_events;
+
+    // HOST_FEATURE_TYPED_EVENTS, blittable struct payloads checked against a layout hash
+    public delegate* unmanaged[Cdecl]<sbyte*, ulong, uint, TypedCallback, bool> register_typed;
+    public delegate* unmanaged[Cdecl]<TypedCallback, void> unregister_typed;
+    public delegate* unmanaged[Cdecl]<sbyte*, ulong, void*, uint, void> send_typed;
+
+    // HOST_FEATURE_WATCH, "prefix*" watches a whole prefix, value is null after a delete
+    public delegate* unmanaged[Cdecl]<sbyte*, EventCallback, ulong> watch_data;
+    public delegate* unmanaged[Cdecl]<ulong, bool> unwatch_data;
+
+    // HOST_FEATURE_TYPED_DATA, add and exchange take int64 or double values
+    public delegate* unmanaged[Cdecl]<sbyte*, DataValue*, bool> set_value;
+    public delegate* unmanaged[Cdecl]<sbyte*, DataValue*, bool> get_value;
+    public delegate* unmanaged[Cdecl]<sbyte*, DataValue*, DataValue*, bool> add_value;
+    public delegate* unmanaged[Cdecl]<sbyte*, DataValue*, DataValue*, bool> compare_and_swap;
+    public delegate* unmanaged[Cdecl]<sbyte*, DataValue*, DataValue*, bool> exchange_value;
+    public delegate* unmanaged[Cdecl]<sbyte*, uint, bool> expire_data;
+
+    // HOST_FEATURE_MEMORY, the calling plugin's arena, freed at unload; alloc_frame lasts one frame
+    public delegate* unmanaged[Cdecl]<uint, void*> alloc_memory;
+    public delegate* unmanaged[Cdecl]<void*, void> free_memory;
+    public delegate* unmanaged[Cdecl]<uint, void*> alloc_frame;
+
+    // HOST_FEATURE_CLOCK, the clock timers run on, in ms
+    public delegate* unmanaged[Cdecl]<ulong> clock_ms;
+
+    // HOST_FEATURE_EVENT_POLICY, held events are delivered at the end of the frame
+    public delegate* unmanaged[Cdecl]<sbyte*, uint, uint, bool> set_event_policy;
+
+    // HOST_FEATURE_METRICS, a METRIC_* series on the metrics page
+    public delegate* unmanaged[Cdecl]<sbyte*, uint, double, bool> set_metric;
+
+    // HOST_FEATURE_USERDATA, handlers called with their userdata; the host never frees it
+    public delegate* unmanaged[Cdecl]<sbyte*, delegate* unmanaged[Cdecl]<void*, sbyte*, sbyte*, void>, void*, ulong> subscribe;
+    public delegate* unmanaged[Cdecl]<ulong, bool> unsubscribe;
+    public delegate* unmanaged[Cdecl]<uint, delegate* unmanaged[Cdecl]<void*, sbyte*, sbyte*, void>, void*, bool, ulong> schedule;
+}
+
+// A delegate registered with the host through a GCHandle, no marshalled thunk per call.
+// Dispose unsubscribes or cancels and releases the delegate
+public sealed unsafe class Subscription : IDisposable
+{
+    public ulong Id { get; private set; }
+    readonly bool timer;
+    GCHandle target;
+
+    internal Subscription(ulong id, bool timer, GCHandle target)
+    {
+        Id = id;
+        this.timer = timer;
+        this.target = target;
+    }
+
+    [UnmanagedCallersOnly(CallConvs = new[] { typeof(CallConvCdecl) })]
+    internal static void Trampoline(void* userdata, sbyte* eventName, sbyte* payload)
+        => ((EventCallback)GCHandle.FromIntPtr((IntPtr)userdata).Target)(eventName, payload);
+
+    public void Dispose()
+    {
+        if (!target.IsAllocated) return;
+        if (Plugin.Host != null)
+        {
+            if (timer) Plugin.Host->cancel_timer(Id);
+            else Plugin.Host->unsubscribe(Id);
+        }
+        target.Free();
+        Id = 0;
+    }
 }
 
 public unsafe static class Plugin
 {
     public static PluginHost* Host;
 
+    // True when the host table has the named entry, e.g. HostHas(nameof(PluginHost.features), 8)
+    public static bool HostHas(string field, int size = 0)
+        => Host != null && Host->abi_version >= PluginConstants.ABI_V2
+           && (int)Marshal.OffsetOf<PluginHost>(field) + (size == 0 ? IntPtr.Size : size) <= Host->table_size;
+
     public static void Send(sbyte* evt, sbyte* payload = null)
         => Host->send_event(evt, payload);
 
@@ -81,25 +255,214 @@ public unsafe static class Plugin
 
     public static void Off(EventCallback cb)
         => Host->unregister_event(cb);
+
+    static bool HasTypedData
+        => HostHas(nameof(PluginHost.expire_data)) && (Host->features & PluginConstants.HOST_FEATURE_TYPED_DATA) != 0;
+
+    public static bool SetValue(sbyte* key, DataValue value)
+        => HasTypedData && Host->set_value(key, &value);
+
+    // DATA_NONE when the key is missing or the host has no typed storage
+    public static DataValue GetValue(sbyte* key)
+    {
+        DataValue result = default;
+        if (HasTypedData) Host->get_value(key, &result);
+        return result;
+    }
+
+    // New value, the key starts at 0 when missing
+    public static long AddInt(sbyte* key, long delta)
+    {
+        if (!HasTypedData) return 0;
+        DataValue d = new DataValue { type = PluginConstants.DATA_INT64, i = delta };
+        DataValue result = default;
+        Host->add_value(key, &d, &result);
+        return result.i;
+    }
+
+    public static double AddDouble(sbyte* key, double delta)
+    {
+        if (!HasTypedData) return 0;
+        DataValue d = new DataValue { type = PluginConstants.DATA_DOUBLE, d = delta };
+        DataValue result = default;
+        Host->add_value(key, &d, &result);
+        return result.d;
+    }
+
+    // Previous value, 0 when the key was missing
+    public static long Exchange(sbyte* key, long value)
+    {
+        if (!HasTypedData) return 0;
+        DataValue v = new DataValue { type = PluginConstants.DATA_INT64, i = value };
+        DataValue previous = default;
+        Host->exchange_value(key, &v, &previous);
+        return previous.i;
+    }
+
+    public static bool CompareAndSwap(sbyte* key, DataValue expected, DataValue desired)
+        => HasTypedData && Host->compare_and_swap(key, &expected, &desired);
+
+    public static bool Expire(sbyte* key, uint ms)
+        => HasTypedData && Host->expire_data(key, ms);
+
+    static bool HasMemory
+        => HostHas(nameof(PluginHost.alloc_frame)) && (Host->features & PluginConstants.HOST_FEATURE_MEMORY) != 0;
+
+    // Host arena memory, null on hosts without it
+    public static void* Alloc(uint size)
+        => HasMemory ? Host->alloc_memory(size) : null;
+
+    public static void Free(void* ptr)
+    {
+        if (HasMemory) Host->free_memory(ptr);
+    }
+
+    // Scratch valid until the end of the current frame
+    public static void* FrameAlloc(uint size)
+        => HasMemory ? Host->alloc_frame(size) : null;
+
+    // The host's timer clock in ms, simulated when the runtime runs with --virtual
+    public static ulong NowMs
+        => HostHas(nameof(PluginHost.clock_ms)) && (Host->features & PluginConstants.HOST_FEATURE_CLOCK) != 0
+            ? Host->clock_ms()
+            : (ulong)Environment.TickCount64;
+
+    // EVENT_POLICY_* for an event name, false on hosts without it
+    public static bool EventPolicy(sbyte* eventName, uint policy, uint windowMs = 0)
+        => HostHas(nameof(PluginHost.set_event_policy)) && (Host->features & PluginConstants.HOST_FEATURE_EVENT_POLICY) != 0
+            && Host->set_event_policy(eventName, policy, windowMs);
+
+    // METRIC_COUNTER or METRIC_GAUGE on the metrics page, false on hosts without it
+    public static bool SetMetric(sbyte* name, uint type, double value)
+        => HostHas(nameof(PluginHost.set_metric)) && (Host->features & PluginConstants.HOST_FEATURE_METRICS) != 0
+            && Host->set_metric(name, type, value);
+
+    static bool HasUserdata
+        => HostHas(nameof(PluginHost.schedule)) && (Host->features & PluginConstants.HOST_FEATURE_USERDATA) != 0;
+
+    // Any delegate, closures included, for as long as the Subscription is not disposed; null on hosts without it
+    public static Subscription Subscribe(sbyte* eventName, EventCallback handler)
+    {
+        if (!HasUserdata) return null;
+        GCHandle target = GCHandle.Alloc(handler);
+        ulong id = Host->subscribe(eventName, &Subscription.Trampoline, (void*)GCHandle.ToIntPtr(target));
+        if (id != 0) return new Subscription(id, false, target);
+        target.Free();
+        return null;
+    }
+
+    public static Subscription Schedule(uint ms, EventCallback handler, bool repeat = false)
+    {
+        if (!HasUserdata) return null;
+        GCHandle target = GCHandle.Alloc(handler);
+        ulong id = Host->schedule(ms, &Subscription.Trampoline, (void*)GCHandle.ToIntPtr(target), repeat);
+        if (id != 0) return new Subscription(id, true, target);
+        target.Free();
+        return null;
+    }
+
+    static bool HasWatch
+        => HostHas(nameof(PluginHost.unwatch_data)) && (Host->features & PluginConstants.HOST_FEATURE_WATCH) != 0;
+
+    public static ulong Watch(sbyte* keyOrPrefix, EventCallback cb)
+        => HasWatch ? Host->watch_data(keyOrPrefix, cb) : 0;
+
+    public static bool Unwatch(ulong watchId)
+        => HasWatch && Host->unwatch_data(watchId);
+
+    static bool HasBatch
+        => HostHas(nameof(PluginHost.register_events)) && (Host->features & PluginConstants.HOST_FEATURE_BATCH) != 0;
+
+    // Batched calls: one native transition per span, per item on older hosts
+
+    public static void SendBatch(ReadOnlySpan<HostEvent> events)
+    {
+        fixed (HostEvent* p = events)
+        {
+            if (HasBatch) { Host->send_events(p, (uint)events.Length); return; }
+            for (int i = 0; i < events.Length; i++) Host->send_event(p[i].name, p[i].payload);
+        }
+    }
+
+    public static uint StoreBatch(ReadOnlySpan<HostKeyValue> items)
+    {
+        fixed (HostKeyValue* p = items)
+        {
+            if (HasBatch) return Host->set_data_many(p, (uint)items.Length);
+            uint stored = 0;
+            for (int i = 0; i < items.Length; i++) if (Host->set_data(p[i].key, p[i].value)) stored++;
+            return stored;
+        }
+    }
+
+    // Values point into host storage and are only valid until the key is written again
+    public static uint LoadBatch(Span<HostKeyValue> items)
+    {
+        fixed (HostKeyValue* p = items)
+        {
+            if (HasBatch) return Host->get_data_many(p, (uint)items.Length);
+            uint found = 0;
+            for (int i = 0; i < items.Length; i++)
+            {
+                p[i].value = Host->get_data(p[i].key);
+                if (p[i].value != null) found++;
+            }
+            return found;
+        }
+    }
+
+    public static void OnBatch(ReadOnlySpan<HostHandler> handlers)
+    {
+        fixed (HostHandler* p = handlers)
+        {
+            if (HasBatch) { Host->register_events(p, (uint)handlers.Length); return; }
+            for (int i = 0; i < handlers.Length; i++)
+            {
+                var cb = Marshal.GetDelegateForFunctionPointer<EventCallback>((IntPtr)p[i].callback);
+                Host->register_event(p[i].eventName, cb);
+            }
+        }
+    }
 }
 
 public unsafe static class PluginExports
 {
-    static PluginInfo info;
+    // Unmanaged so the host can keep the pointer
+    static PluginInfoV2* info;
+
+    // Dependencies and capabilities, e.g. ("other.dll", DESC_DEPENDENCY, DEP_TYPE_REQUIRED)
+    static readonly (string name, byte kind, byte type)[] Descriptors = { };
 
     static PluginExports()
     {
-        info = new PluginInfo
+        var descriptors = (PluginDescriptor*)Marshal.AllocHGlobal(
+            Math.Max(1, Descriptors.Length) * sizeof(PluginDescriptor));
+        for (int i = 0; i < Descriptors.Length; i++)
+        {
+            descriptors[i] = new PluginDescriptor
+            {
+                name = (sbyte*)Marshal.StringToHGlobalAnsi(Descriptors[i].name),
+                kind = Descriptors[i].kind,
+                type = Descriptors[i].type
+            };
+        }
+
+        info = (PluginInfoV2*)Marshal.AllocHGlobal(sizeof(PluginInfoV2));
+        *info = new PluginInfoV2
         {
             name = (sbyte*)Marshal.StringToHGlobalAnsi("ExamplePlugin"),
             version = (sbyte*)Marshal.StringToHGlobalAnsi("1.0.0"),
-            abi_version = PluginConstants.ABI_V1,
-            priority = PluginConstants.PRIORITY_DEFAULT
+            abi_version = PluginConstants.ABI_V2,
+            priority = PluginConstants.PRIORITY_DEFAULT,
+            descriptor_count = (uint)Descriptors.Length,
+            descriptors = descriptors,
+            features = 0,
+            host_table_size = (uint)sizeof(PluginHost)
         };
     }
 
     [UnmanagedCallersOnly(EntryPoint = "plugin_get_info", CallConvs = new[] { typeof(CallConvCdecl) })]
-    public static PluginInfo* GetInfo() => &info;
+    public static PluginInfo* GetInfo() => (PluginInfo*)info;
 
     [UnmanagedCallersOnly(EntryPoint = "plugin_init", CallConvs = new[] { typeof(CallConvCdecl) })]
     public static bool Init(PluginHost* host)
@@ -4,8 +4,11 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdlib.h>
 
 #define ABI_V1 1
+#define ABI_V2 2
+#define ABI_CURRENT ABI_V2
 
 #define PRIORITY_DEFAULT 1
 #define PRIORITY_FIRST 0
@@ -14,6 +17,42 @@
 #define DEP_TYPE_REQUIRED 0
 #define DEP_TYPE_OPTIONAL 1
 
+/* DataValue types */
+#define DATA_NONE 0
+#define DATA_STRING 1
+#define DATA_INT64 2
+#define DATA_DOUBLE 3
+#define DATA_BYTES 4
+
+/* PluginDescriptor kinds (ABI v2) */
+#define DESC_DEPENDENCY 0
+#define DESC_CAPABILITY 1
+
+/* PluginInfoV2 features */
+#define PLUGIN_FEATURE_THREAD_SAFE (1ull << 0)
+
+/* PluginHost features */
+#define HOST_FEATURE_BATCH (1ull << 0)
+#define HOST_FEATURE_TYPED_EVENTS (1ull << 1)
+#define HOST_FEATURE_WATCH (1ull << 2)
+#define HOST_FEATURE_TYPED_DATA (1ull << 3)
+#define HOST_FEATURE_MEMORY (1ull << 4)
+#define HOST_FEATURE_CLOCK (1ull << 5)
+#define HOST_FEATURE_EVENT_POLICY (1ull << 6)
+#define HOST_FEATURE_METRICS (1ull << 7)
+#define HOST_FEATURE_USERDATA (1ull << 8)
+
+#define EVENT_POLICY_IMMEDIATE 0
+#define EVENT_POLICY_LATEST 1
+#define EVENT_POLICY_KEYED 2
+#define EVENT_POLICY_DEBOUNCE 3
+#define EVENT_POLICY_THROTTLE 4
+
+#define METRIC_COUNTER 0
+#define METRIC_GAUGE 1
+
+#define PLUGIN_MAX_DESCRIPTORS 64
+
 /* Calling convention */
 #ifdef _WIN32
     #define pluginbhvr __cdecl
@@ -38,6 +77,7 @@ struct Dependency {
     uint8_t type;
 };
 
+/* ABI v1 layout, still accepted by the host */
 struct PluginInfo {
     const char* name;
     const char* version;
@@ -46,10 +86,55 @@ struct PluginInfo {
     struct Dependency dependencies[128];
 };
 
+/* ABI v2: dependencies and capabilities as one variable length list */
+struct PluginDescriptor {
+    const char* name;
+    uint8_t kind;
+    uint8_t type;
+};
+
+struct PluginInfoV2 {
+    const char* name;
+    const char* version;
+    uint32_t abi_version;
+    char priority;
+    uint32_t descriptor_count;
+    const struct PluginDescriptor* descriptors;
+    uint64_t features;
+    uint32_t host_table_size;
+};
+
 /* Callback types */
 typedef void (*event_callback_t)(const char* eventName, const char* payload);
+typedef void (*event_handler_t)(void* userdata, const char* eventName, const char* payload);
+typedef void (*typed_callback_t)(const char* eventName, const void* data, uint32_t size);
 typedef void (*log_callback_t)(const char* level, const char* message);
 
+/* Batched call elements */
+struct HostEvent {
+    const char* name;
+    const char* payload;
+};
+
+struct HostKeyValue {
+    const char* key;
+    const char* value;
+};
+
+struct HostHandler {
+    const char* eventName;
+    event_callback_t callback;
+};
+
+/* Typed storage value, only the field matching type is used */
+struct DataValue {
+    uint32_t type;
+    uint32_t size;
+    int64_t i;
+    double d;
+    const void* data;
+};
+
 /* Host interface */
 struct PluginHost {
     void (*send_event)(const char* eventName, const char* payload);
@@ -68,8 +153,59 @@ struct PluginHost {
 
     uint64_t (*set_timer)(uint32_t ms, event_callback_t callback, bool repeat);
     bool (*cancel_timer)(uint64_t timer_id);
+
+    /* ABI v2, everything below is only there when table_size covers it */
+    uint32_t abi_version;
+    uint32_t table_size;
+    uint64_t features;
+
+    /* HOST_FEATURE_BATCH */
+    void (*send_events)(const struct HostEvent* events, uint32_t count);
+    uint32_t (*set_data_many)(const struct HostKeyValue* items, uint32_t count);
+    uint32_t (*get_data_many)(struct HostKeyValue* items, uint32_t count);
+    void (*register_events)(const struct HostHandler* handlers, uint32_t count);
+
+    /* HOST_FEATURE_TYPED_EVENTS, raw struct payloads checked against a layout hash */
+    bool (*register_typed)(const char* eventName, uint64_t layoutHash, uint32_t size, typed_callback_t callback);
+    void (*unregister_typed)(typed_callback_t callback);
+    void (*send_typed)(const char* eventName, uint64_t layoutHash, const void* data, uint32_t size);
+
+    /* HOST_FEATURE_WATCH, "prefix*" watches a whole prefix, value is NULL after a delete */
+    uint64_t (*watch_data)(const char* keyOrPrefix, event_callback_t callback);
+    bool (*unwatch_data)(uint64_t watchId);
+
+    /* HOST_FEATURE_TYPED_DATA, add and exchange take int64 or double values */
+    bool (*set_value)(const char* key, const struct DataValue* value);
+    bool (*get_value)(const char* key, struct DataValue* out);
+    bool (*add_value)(const char* key, const struct DataValue* delta, struct DataValue* result);
+    bool (*compare_and_swap)(const char* key, const struct DataValue* expected, const struct DataValue* desired);
+    bool (*exchange_value)(const char* key, const struct DataValue* value, struct DataValue* previous);
+    bool (*expire_data)(const char* key, uint32_t ms);
+
+    /* HOST_FEATURE_MEMORY, the calling plugin's arena, freed at unload; alloc_frame lasts one frame */
+    void* (*alloc_memory)(uint32_t size);
+    void (*free_memory)(void* ptr);
+    void* (*alloc_frame)(uint32_t size);
+
+    /* HOST_FEATURE_CLOCK, the clock timers run on, in ms */
+    uint64_t (*clock_ms)(void);
+
+    /* HOST_FEATURE_EVENT_POLICY, held events are delivered at the end of the frame */
+    bool (*set_event_policy)(const char* eventName, uint32_t policy, uint32_t windowMs);
+
+    /* HOST_FEATURE_METRICS, a METRIC_* series on the metrics page */
+    bool (*set_metric)(const char* name, uint32_t type, double value);
+
+    /* HOST_FEATURE_USERDATA, handlers called with their userdata; the host never frees it */
+    uint64_t (*subscribe)(const char* eventName, event_handler_t handler, void* userdata);
+    bool (*unsubscribe)(uint64_t handle);
+    uint64_t (*schedule)(uint32_t ms, event_handler_t handler, void* userdata, bool repeat);
 };
 
+#define PLUGIN_HOST_HAS(h, member) \
+    ((h)->abi_version >= ABI_V2 && \
+     offsetof(struct PluginHost, member) + sizeof((h)->member) <= (h)->table_size)
+
 /* Entry point types */
 typedef bool (*plugin_init_t)(struct PluginHost* host);
 typedef void (*plugin_shutdown_t)(void);
@@ -118,14 +254,200 @@ static inline void plugin_off(event_callback_t callback)
     if (plugin_host) plugin_host->unregister_event(callback);
 }
 
+static inline uint64_t plugin_watch(const char* keyOrPrefix, event_callback_t callback)
+{
+    if (!plugin_host || !PLUGIN_HOST_HAS(plugin_host, unwatch_data) ||
+        !(plugin_host->features & HOST_FEATURE_WATCH)) return 0;
+    return plugin_host->watch_data(keyOrPrefix, callback);
+}
+
+static inline bool plugin_unwatch(uint64_t watchId)
+{
+    if (!plugin_host || !PLUGIN_HOST_HAS(plugin_host, unwatch_data) ||
+        !(plugin_host->features & HOST_FEATURE_WATCH)) return false;
+    return plugin_host->unwatch_data(watchId);
+}
+
+static inline bool plugin_has_typed_data(void)
+{
+    return plugin_host && PLUGIN_HOST_HAS(plugin_host, expire_data) &&
+           (plugin_host->features & HOST_FEATURE_TYPED_DATA);
+}
+
+static inline bool plugin_set_value(const char* key, const struct DataValue* value)
+{
+    return plugin_has_typed_data() ? plugin_host->set_value(key, value) : false;
+}
+
+/* out is DATA_NONE when the key is missing */
+static inline bool plugin_get_value(const char* key, struct DataValue* out)
+{
+    struct DataValue none = {DATA_NONE, 0, 0, 0.0, NULL};
+    *out = none;
+    return plugin_has_typed_data() ? plugin_host->get_value(key, out) : false;
+}
+
+/* New value, the key starts at 0 when missing */
+static inline int64_t plugin_add_int(const char* key, int64_t delta)
+{
+    struct DataValue d = {DATA_INT64, 0, delta, 0.0, NULL};
+    struct DataValue result = {DATA_NONE, 0, 0, 0.0, NULL};
+    if (plugin_has_typed_data()) plugin_host->add_value(key, &d, &result);
+    return result.i;
+}
+
+static inline double plugin_add_double(const char* key, double delta)
+{
+    struct DataValue d = {DATA_DOUBLE, 0, 0, delta, NULL};
+    struct DataValue result = {DATA_NONE, 0, 0, 0.0, NULL};
+    if (plugin_has_typed_data()) plugin_host->add_value(key, &d, &result);
+    return result.d;
+}
+
+static inline bool plugin_compare_and_swap(const char* key, const struct DataValue* expected,
+                                           const struct DataValue* desired)
+{
+    return plugin_has_typed_data() ? plugin_host->compare_and_swap(key, expected, desired) : false;
+}
+
+/* Previous value, 0 when the key was missing */
+static inline int64_t plugin_exchange(const char* key, int64_t value)
+{
+    struct DataValue v = {DATA_INT64, 0, value, 0.0, NULL};
+    struct DataValue previous = {DATA_NONE, 0, 0, 0.0, NULL};
+    if (plugin_has_typed_data()) plugin_host->exchange_value(key, &v, &previous);
+    return previous.i;
+}
+
+static inline bool plugin_expire(const char* key, uint32_t ms)
+{
+    return plugin_has_typed_data() ? plugin_host->expire_data(key, ms) : false;
+}
+
+static inline bool plugin_has_memory(void)
+{
+    return plugin_host && PLUGIN_HOST_HAS(plugin_host, alloc_frame) &&
+           (plugin_host->features & HOST_FEATURE_MEMORY);
+}
+
+/* Host arena memory, malloc/free on hosts without it */
+static inline void* plugin_alloc(uint32_t size)
+{
+    return plugin_has_memory() ? plugin_host->alloc_memory(size) : malloc(size);
+}
+
+static inline void plugin_free(void* ptr)
+{
+    if (plugin_has_memory()) plugin_host->free_memory(ptr);
+    else free(ptr);
+}
+
+static inline void* plugin_frame_alloc(uint32_t size)
+{
+    return plugin_has_memory() ? plugin_host->alloc_frame(size) : NULL;
+}
+
+/* The host's timer clock in ms, 0 on hosts without it */
+static inline uint64_t plugin_now_ms(void)
+{
+    if (plugin_host && PLUGIN_HOST_HAS(plugin_host, clock_ms) && (plugin_host->features & HOST_FEATURE_CLOCK))
+        return plugin_host->clock_ms();
+    return 0;
+}
+
+/* EVENT_POLICY_* for an event name, false on hosts without it */
+static inline bool plugin_event_policy(const char* eventName, uint32_t policy, uint32_t windowMs)
+{
+    if (plugin_host && PLUGIN_HOST_HAS(plugin_host, set_event_policy) && (plugin_host->features & HOST_FEATURE_EVENT_POLICY))
+        return plugin_host->set_event_policy(eventName, policy, windowMs);
+    return false;
+}
+
+/* METRIC_COUNTER or METRIC_GAUGE on the metrics page, false on hosts without it */
+static inline bool plugin_set_metric(const char* name, uint32_t type, double value)
+{
+    if (plugin_host && PLUGIN_HOST_HAS(plugin_host, set_metric) && (plugin_host->features & HOST_FEATURE_METRICS))
+        return plugin_host->set_metric(name, type, value);
+    return false;
+}
+
+/* A closure in C: handler(userdata, eventName, payload). Returns a handle, 0 on hosts without it */
+static inline uint64_t plugin_subscribe(const char* eventName, event_handler_t handler, void* userdata)
+{
+    if (plugin_host && PLUGIN_HOST_HAS(plugin_host, schedule) && (plugin_host->features & HOST_FEATURE_USERDATA))
+        return plugin_host->subscribe(eventName, handler, userdata);
+    return 0;
+}
+
+static inline bool plugin_unsubscribe(uint64_t handle)
+{
+    if (plugin_host && PLUGIN_HOST_HAS(plugin_host, schedule) && (plugin_host->features & HOST_FEATURE_USERDATA))
+        return plugin_host->unsubscribe(handle);
+    return false;
+}
+
+/* Timer id for cancel_timer, 0 on hosts without it */
+static inline uint64_t plugin_schedule(uint32_t ms, event_handler_t handler, void* userdata, bool repeat)
+{
+    if (plugin_host && PLUGIN_HOST_HAS(plugin_host, schedule) && (plugin_host->features & HOST_FEATURE_USERDATA))
+        return plugin_host->schedule(ms, handler, userdata, repeat);
+    return 0;
+}
+
+static inline bool plugin_has_batch(void)
+{
+    return plugin_host && plugin_host->abi_version >= ABI_V2 &&
+           (plugin_host->features & HOST_FEATURE_BATCH);
+}
+
+static inline void plugin_send_many(const struct HostEvent* events, uint32_t count)
+{
+    uint32_t i;
+    if (!plugin_host) return;
+    if (plugin_has_batch()) { plugin_host->send_events(events, count); return; }
+    for (i = 0; i < count; i++) plugin_host->send_event(events[i].name, events[i].payload);
+}
+
+static inline uint32_t plugin_store_many(const struct HostKeyValue* items, uint32_t count)
+{
+    uint32_t i, stored = 0;
+    if (!plugin_host) return 0;
+    if (plugin_has_batch()) return plugin_host->set_data_many(items, count);
+    for (i = 0; i < count; i++) stored += plugin_host->set_data(items[i].key, items[i].value) ? 1 : 0;
+    return stored;
+}
+
+static inline uint32_t plugin_load_many(struct HostKeyValue* items, uint32_t count)
+{
+    uint32_t i, found = 0;
+    if (!plugin_host) return 0;
+    if (plugin_has_batch()) return plugin_host->get_data_many(items, count);
+    for (i = 0; i < count; i++) {
+        items[i].value = plugin_host->get_data(items[i].key);
+        if (items[i].value) found++;
+    }
+    return found;
+}
+
+static inline void plugin_on_many(const struct HostHandler* handlers, uint32_t count)
+{
+    uint32_t i;
+    if (!plugin_host) return;
+    if (plugin_has_batch()) { plugin_host->register_events(handlers, count); return; }
+    for (i = 0; i < count; i++) plugin_host->register_event(handlers[i].eventName, handlers[i].callback);
+}
+
 /* ================= Macros ================= */
 
 #define manifest(name, version)                                  \
+    static struct PluginDescriptor                              \
+        plugin_descriptors[PLUGIN_MAX_DESCRIPTORS];             \
+    static struct PluginInfoV2 plugin_manifest_info = {         \
+        name, version, ABI_V2, PRIORITY_DEFAULT, 0,             \
+        plugin_descriptors, 0, sizeof(struct PluginHost)        \
+    };                                                           \
     api const struct PluginInfo* plugin_get_info(void) {        \
-        static struct PluginInfo info = {                       \
-            name, version, ABI_V1, PRIORITY_DEFAULT, {0}        \
-        };                                                       \
-        return &info;                                           \
+        return (const struct PluginInfo*)&plugin_manifest_info; \
     }
 
 #define start() \
@@ -134,20 +456,28 @@ static inline void plugin_off(event_callback_t callback)
 #define sethost() \
     plugin_host = host;
 
-#define dependency(dep_name, dep_type)                          \
+/* Needs manifest() earlier in the same file */
+#define plugin_describe(desc_name, desc_kind, desc_type)        \
     do {                                                        \
-        struct PluginInfo* info =                               \
-            (struct PluginInfo*)plugin_get_info();             \
-        struct Dependency dep = { dep_name, dep_type };        \
-        for (size_t i = 0; i < 128; ++i) {                     \
-            if (!info->dependencies[i].name ||                 \
-                info->dependencies[i].name[0] == '\0') {      \
-                info->dependencies[i] = dep;                   \
-                break;                                         \
-            }                                                   \
+        uint32_t n = plugin_manifest_info.descriptor_count;    \
+        if (n < PLUGIN_MAX_DESCRIPTORS) {                       \
+            struct PluginDescriptor d = {                       \
+                desc_name, desc_kind, desc_type                 \
+            };                                                  \
+            plugin_descriptors[n] = d;                          \
+            plugin_manifest_info.descriptor_count = n + 1;      \
         }                                                       \
     } while (0)
 
+#define dependency(dep_name, dep_type) \
+    plugin_describe(dep_name, DESC_DEPENDENCY, dep_type)
+
+#define capability(cap_name) \
+    plugin_describe(cap_name, DESC_CAPABILITY, 0)
+
+#define plugin_features(bits) \
+    do { plugin_manifest_info.features |= (bits); } while (0)
+
 #define event_handler(name) \
     static void name(const char* eventName, const char* payload)
 
@@ -6,10 +6,13 @@
 #![allow(non_snake_case)]
 #![allow(dead_code)]
 
-use std::ffi::c_char;
+use std::ffi::{c_char, c_void, CStr};
+use std::marker::PhantomData;
 use std::ptr;
 
 pub const ABI_V1: u32 = 1;
+pub const ABI_V2: u32 = 2;
+pub const ABI_CURRENT: u32 = ABI_V2;
 
 pub const PRIORITY_DEFAULT: i8 = 1;
 pub const PRIORITY_FIRST: i8 = 0;
@@ -18,7 +21,39 @@ pub const PRIORITY_LATER: i8 = 2;
 pub const DEP_TYPE_REQUIRED: u8 = 0;
 pub const DEP_TYPE_OPTIONAL: u8 = 1;
 
+pub const DESC_DEPENDENCY: u8 = 0;
+pub const DESC_CAPABILITY: u8 = 1;
+
+pub const PLUGIN_FEATURE_THREAD_SAFE: u64 = 1 << 0;
+
+pub const HOST_FEATURE_BATCH: u64 = 1 << 0;
+pub const HOST_FEATURE_TYPED_EVENTS: u64 = 1 << 1;
+pub const HOST_FEATURE_WATCH: u64 = 1 << 2;
+pub const HOST_FEATURE_TYPED_DATA: u64 = 1 << 3;
+pub const HOST_FEATURE_MEMORY: u64 = 1 << 4;
+pub const HOST_FEATURE_CLOCK: u64 = 1 << 5;
+pub const HOST_FEATURE_EVENT_POLICY: u64 = 1 << 6;
+pub const HOST_FEATURE_METRICS: u64 = 1 << 7;
+pub const HOST_FEATURE_USERDATA: u64 = 1 << 8;
+
+pub const EVENT_POLICY_IMMEDIATE: u32 = 0;
+pub const EVENT_POLICY_LATEST: u32 = 1;
+pub const EVENT_POLICY_KEYED: u32 = 2;
+pub const EVENT_POLICY_DEBOUNCE: u32 = 3;
+pub const EVENT_POLICY_THROTTLE: u32 = 4;
+
+pub const METRIC_COUNTER: u32 = 0;
+pub const METRIC_GAUGE: u32 = 1;
+
+pub const DATA_NONE: u32 = 0;
+pub const DATA_STRING: u32 = 1;
+pub const DATA_INT64: u32 = 2;
+pub const DATA_DOUBLE: u32 = 3;
+pub const DATA_BYTES: u32 = 4;
+
 pub type event_callback_t = extern "C" fn(*const c_char, *const c_char);
+pub type typed_callback_t = extern "C" fn(*const c_char, *const c_void, u32);
+pub type event_handler_t = extern "C" fn(*mut c_void, *const c_char, *const c_char);
 
 #[repr(C)]
 #[derive(Copy, Clone)]
@@ -37,6 +72,104 @@ pub struct PluginInfo {
     pub dependencies: [Dependency; 128],
 }
 
+#[repr(C)]
+#[derive(Copy, Clone)]
+pub struct PluginDescriptor {
+    pub name: *const c_char,
+    pub kind: u8,
+    pub r#type: u8,
+}
+
+// Descriptors only ever point at static strings
+unsafe impl Sync for PluginDescriptor {}
+
+// ABI v2, shares its first fields with PluginInfo
+#[repr(C)]
+pub struct PluginInfoV2 {
+    pub name: *const c_char,
+    pub version: *const c_char,
+    pub abi_version: u32,
+    pub priority: i8,
+    pub _pad: [u8; 3],
+    pub descriptor_count: u32,
+    pub descriptors: *const PluginDescriptor,
+    pub features: u64,
+    pub host_table_size: u32,
+}
+
+// Batched call elements, the lifetime ties them to the strings they point at
+#[repr(C)]
+#[derive(Copy, Clone)]
+pub struct HostEvent<'a> {
+    pub name: *const c_char,
+    pub payload: *const c_char,
+    _borrow: PhantomData<&'a CStr>,
+}
+
+impl<'a> HostEvent<'a> {
+    pub fn new(name: &'a CStr, payload: &'a CStr) -> Self {
+        HostEvent { name: name.as_ptr(), payload: payload.as_ptr(), _borrow: PhantomData }
+    }
+}
+
+#[repr(C)]
+#[derive(Copy, Clone)]
+pub struct HostKeyValue<'a> {
+    pub key: *const c_char,
+    pub value: *const c_char,
+    _borrow: PhantomData<&'a CStr>,
+}
+
+impl<'a> HostKeyValue<'a> {
+    pub fn new(key: &'a CStr, value: &'a CStr) -> Self {
+        HostKeyValue { key: key.as_ptr(), value: value.as_ptr(), _borrow: PhantomData }
+    }
+
+    // For load_batch, value is filled in by the host
+    pub fn key(key: &'a CStr) -> Self {
+        HostKeyValue { key: key.as_ptr(), value: ptr::null(), _borrow: PhantomData }
+    }
+
+    // Host owned, only valid until the key is written again
+    pub fn value(&self) -> Option<&CStr> {
+        if self.value.is_null() { None } else { Some(unsafe { CStr::from_ptr(self.value) }) }
+    }
+}
+
+#[repr(C)]
+#[derive(Copy, Clone)]
+pub struct HostHandler<'a> {
+    pub event_name: *const c_char,
+    pub callback: event_callback_t,
+    _borrow: PhantomData<&'a CStr>,
+}
+
+impl<'a> HostHandler<'a> {
+    pub fn new(event_name: &'a CStr, callback: event_callback_t) -> Self {
+        HostHandler { event_name: event_name.as_ptr(), callback, _borrow: PhantomData }
+    }
+}
+
+/// Typed storage value, only the field matching `type_` is used
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct DataValue {
+    pub type_: u32,
+    pub size: u32,
+    pub i: i64,
+    pub d: f64,
+    pub data: *const c_void,
+}
+
+impl DataValue {
+    pub fn none() -> Self { DataValue { type_: DATA_NONE, size: 0, i: 0, d: 0.0, data: ptr::null() } }
+    pub fn int(v: i64) -> Self { DataValue { type_: DATA_INT64, i: v, ..Self::none() } }
+    pub fn double(v: f64) -> Self { DataValue { type_: DATA_DOUBLE, d: v, ..Self::none() } }
+    pub fn bytes(v: &[u8]) -> Self {
+        DataValue { type_: DATA_BYTES, size: v.len() as u32, data: v.as_ptr() as *const c_void, ..Self::none() }
+    }
+}
+
 #[repr(C)]
 pub struct PluginHost {
     pub send_event: extern "C" fn(*const c_char, *const c_char),
@@ -55,31 +188,114 @@ pub struct PluginHost {
 
     pub set_timer: extern "C" fn(u32, event_callback_t, bool) -> u64,
     pub cancel_timer: extern "C" fn(u64) -> bool,
+
+    // ABI v2, entries below are only valid when table_size covers them
+    pub abi_version: u32,
+    pub table_size: u32,
+    pub features: u64,
+
+    // HOST_FEATURE_BATCH
+    pub send_events: extern "C" fn(*const HostEvent<'static>, u32),
+    pub set_data_many: extern "C" fn(*const HostKeyValue<'static>, u32) -> u32,
+    pub get_data_many: extern "C" fn(*mut HostKeyValue<'static>, u32) -> u32,
+    pub register_events: extern "C" fn(*const HostHandler<'static>, u32),
+
+    // HOST_FEATURE_TYPED_EVENTS, raw #[repr(C)] payloads checked against a layout hash
+    pub register_typed: extern "C" fn(*const c_char, u64, u32, typed_callback_t) -> bool,
+    pub unregister_typed: extern "C" fn(typed_callback_t),
+    pub send_typed: extern "C" fn(*const c_char, u64, *const c_void, u32),
+
+    // HOST_FEATURE_WATCH, "prefix*" watches a whole prefix, value is null after a delete
+    pub watch_data: extern "C" fn(*const c_char, event_callback_t) -> u64,
+    pub unwatch_data: extern "C" fn(u64) -> bool,
+
+    // HOST_FEATURE_TYPED_DATA, add and exchange take int64 or double values
+    pub set_value: extern "C" fn(*const c_char, *const DataValue) -> bool,
+    pub get_value: extern "C" fn(*const c_char, *mut DataValue) -> bool,
+    pub add_value: extern "C" fn(*const c_char, *const DataValue, *mut DataValue) -> bool,
+    pub compare_and_swap: extern "C" fn(*const c_char, *const DataValue, *const DataValue) -> bool,
+    pub exchange_value: extern "C" fn(*const c_char, *const DataValue, *mut DataValue) -> bool,
+    pub expire_data: extern "C" fn(*const c_char, u32) -> bool,
+
+    // HOST_FEATURE_MEMORY, the calling plugin's arena, freed at unload; alloc_frame lasts one frame
+    pub alloc_memory: extern "C" fn(u32) -> *mut c_void,
+    pub free_memory: extern "C" fn(*mut c_void),
+    pub alloc_frame: extern "C" fn(u32) -> *mut c_void,
+
+    // HOST_FEATURE_CLOCK, the clock timers run on, in ms
+    pub clock_ms: extern "C" fn() -> u64,
+
+    // HOST_FEATURE_EVENT_POLICY, held events are delivered at the end of the frame
+    pub set_event_policy: extern "C" fn(*const c_char, u32, u32) -> bool,
+
+    // HOST_FEATURE_METRICS, a METRIC_* series on the metrics page
+    pub set_metric: extern "C" fn(*const c_char, u32, f64) -> bool,
+
+    // HOST_FEATURE_USERDATA, handlers called with their userdata; the host never frees it
+    pub subscribe: extern "C" fn(*const c_char, event_handler_t, *mut c_void) -> u64,
+    pub unsubscribe: extern "C" fn(u64) -> bool,
+    pub schedule: extern "C" fn(u32, event_handler_t, *mut c_void, bool) -> u64,
 }
 
-static mut HOST: *mut PluginHost = ptr::null_mut();
+// True when the host table passed to plugin_init has the given entry
+#[macro_export]
+macro_rules! host_has {
+    ($field:ident) => {
+        unsafe {
+            !$crate::HOST.is_null() && {
+                let h = &*$crate::HOST;
+                h.abi_version >= $crate::ABI_V2
+                    && core::mem::offset_of!($crate::PluginHost, $field) + core::mem::size_of_val(&h.$field)
+                        <= h.table_size as usize
+            }
+        }
+    };
+}
+
+pub(crate) static mut HOST: *mut PluginHost = ptr::null_mut();
 
+// The entry points below are an example to edit. A crate with entry points of
+// its own can instead include this file as a module, built with --cfg api_module:
+//   #[path = "api.rs"] mod api;
+//   use api::*; // host_has! expects HOST and PluginHost at the crate root
+// and set api::HOST in its plugin_init
+#[cfg(not(api_module))]
 #[no_mangle]
 pub extern "C" fn plugin_init(host: *mut PluginHost) -> bool {
     unsafe { HOST = host; }
     true
 }
 
+#[cfg(not(api_module))]
 #[no_mangle]
 pub extern "C" fn plugin_shutdown() {}
 
-static mut INFO: PluginInfo = PluginInfo {
+#[cfg(not(api_module))]
+static DESCRIPTORS: [PluginDescriptor; 0] = [
+    // PluginDescriptor { name: b"other.so\0".as_ptr() as _, kind: DESC_DEPENDENCY, r#type: DEP_TYPE_REQUIRED },
+];
+
+#[cfg(not(api_module))]
+static mut INFO: PluginInfoV2 = PluginInfoV2 {
     name: b"ExamplePlugin\0".as_ptr() as _,
     version: b"1.0.0\0".as_ptr() as _,
-    abi_version: ABI_V1,
+    abi_version: ABI_V2,
     priority: PRIORITY_DEFAULT,
     _pad: [0; 3],
-    dependencies: [Dependency { name: ptr::null(), r#type: 0 }; 128],
+    descriptor_count: 0,
+    descriptors: ptr::null(),
+    features: 0,
+    host_table_size: core::mem::size_of::<PluginHost>() as u32,
 };
 
+#[cfg(not(api_module))]
 #[no_mangle]
 pub extern "C" fn plugin_get_info() -> *const PluginInfo {
-    unsafe { &INFO }
+    unsafe {
+        INFO.descriptor_count = DESCRIPTORS.len() as u32;
+        INFO.descriptors = DESCRIPTORS.as_ptr();
+        ptr::addr_of!(INFO) as *const PluginInfo
+    }
 }
 
 /* ---------------- Helper API ---------------- */
@@ -122,4 +338,232 @@ pub mod plugin {
             ((*super::HOST).unregister_event)(cb);
         }
     }
+
+    fn has_watch() -> bool {
+        host_has!(unwatch_data) && unsafe { (*super::HOST).features & HOST_FEATURE_WATCH != 0 }
+    }
+
+    pub unsafe fn watch(key_or_prefix: *const c_char, cb: event_callback_t) -> u64 {
+        if has_watch() { ((*super::HOST).watch_data)(key_or_prefix, cb) } else { 0 }
+    }
+
+    pub unsafe fn unwatch(watch_id: u64) -> bool {
+        has_watch() && ((*super::HOST).unwatch_data)(watch_id)
+    }
+
+    fn has_typed_data() -> bool {
+        host_has!(expire_data) && unsafe { (*super::HOST).features & HOST_FEATURE_TYPED_DATA != 0 }
+    }
+
+    /// New value, the key starts at 0 when missing
+    pub fn add_int(key: &CStr, delta: i64) -> Option<i64> {
+        if !has_typed_data() { return None; }
+        let d = DataValue::int(delta);
+        let mut result = DataValue::none();
+        unsafe { ((*super::HOST).add_value)(key.as_ptr(), &d, &mut result) }.then_some(result.i)
+    }
+
+    pub fn add_double(key: &CStr, delta: f64) -> Option<f64> {
+        if !has_typed_data() { return None; }
+        let d = DataValue::double(delta);
+        let mut result = DataValue::none();
+        unsafe { ((*super::HOST).add_value)(key.as_ptr(), &d, &mut result) }.then_some(result.d)
+    }
+
+    /// Previous value, 0 when the key was missing
+    pub fn exchange(key: &CStr, value: i64) -> Option<i64> {
+        if !has_typed_data() { return None; }
+        let v = DataValue::int(value);
+        let mut previous = DataValue::none();
+        unsafe { ((*super::HOST).exchange_value)(key.as_ptr(), &v, &mut previous) }.then_some(previous.i)
+    }
+
+    pub fn compare_and_swap(key: &CStr, expected: &DataValue, desired: &DataValue) -> bool {
+        has_typed_data() && unsafe { ((*super::HOST).compare_and_swap)(key.as_ptr(), expected, desired) }
+    }
+
+    pub fn get_value(key: &CStr) -> DataValue {
+        let mut out = DataValue::none();
+        if has_typed_data() {
+            unsafe { ((*super::HOST).get_value)(key.as_ptr(), &mut out) };
+        }
+        out
+    }
+
+    pub fn set_value(key: &CStr, value: &DataValue) -> bool {
+        has_typed_data() && unsafe { ((*super::HOST).set_value)(key.as_ptr(), value) }
+    }
+
+    pub fn expire(key: &CStr, ms: u32) -> bool {
+        has_typed_data() && unsafe { ((*super::HOST).expire_data)(key.as_ptr(), ms) }
+    }
+
+    fn has_memory() -> bool {
+        host_has!(alloc_frame) && unsafe { (*super::HOST).features & HOST_FEATURE_MEMORY != 0 }
+    }
+
+    /// Host arena memory, null on hosts without HOST_FEATURE_MEMORY
+    pub fn alloc(size: u32) -> *mut c_void {
+        if has_memory() { unsafe { ((*super::HOST).alloc_memory)(size) } } else { std::ptr::null_mut() }
+    }
+
+    pub unsafe fn free(ptr: *mut c_void) {
+        if has_memory() { ((*super::HOST).free_memory)(ptr) }
+    }
+
+    /// Scratch valid until the end of the current frame
+    pub fn frame_alloc(size: u32) -> *mut c_void {
+        if has_memory() { unsafe { ((*super::HOST).alloc_frame)(size) } } else { std::ptr::null_mut() }
+    }
+
+    /// The host's timer clock in ms, simulated under --virtual; time since first use on older hosts
+    pub fn now_ms() -> u64 {
+        if host_has!(clock_ms) && unsafe { (*super::HOST).features & HOST_FEATURE_CLOCK != 0 } {
+            unsafe { ((*super::HOST).clock_ms)() }
+        } else {
+            static START: std::sync::OnceLock<std::time::Instant> = std::sync::OnceLock::new();
+            START.get_or_init(std::time::Instant::now).elapsed().as_millis() as u64
+        }
+    }
+
+    /// EVENT_POLICY_* for an event name, false on hosts without HOST_FEATURE_EVENT_POLICY
+    pub fn event_policy(event: &CStr, policy: u32, window_ms: u32) -> bool {
+        host_has!(set_event_policy)
+            && unsafe { (*super::HOST).features & HOST_FEATURE_EVENT_POLICY != 0 }
+            && unsafe { ((*super::HOST).set_event_policy)(event.as_ptr(), policy, window_ms) }
+    }
+
+    /// METRIC_COUNTER or METRIC_GAUGE on the metrics page, false on hosts without HOST_FEATURE_METRICS
+    pub fn set_metric(name: &CStr, kind: u32, value: f64) -> bool {
+        host_has!(set_metric)
+            && unsafe { (*super::HOST).features & HOST_FEATURE_METRICS != 0 }
+            && unsafe { ((*super::HOST).set_metric)(name.as_ptr(), kind, value) }
+    }
+
+    fn has_userdata() -> bool {
+        host_has!(schedule) && unsafe { (*super::HOST).features & HOST_FEATURE_USERDATA != 0 }
+    }
+
+    pub unsafe fn subscribe_raw(evt: *const c_char, handler: event_handler_t, userdata: *mut c_void) -> u64 {
+        if has_userdata() { ((*super::HOST).subscribe)(evt, handler, userdata) } else { 0 }
+    }
+
+    pub fn unsubscribe(handle: u64) -> bool {
+        has_userdata() && unsafe { ((*super::HOST).unsubscribe)(handle) }
+    }
+
+    pub unsafe fn schedule_raw(ms: u32, handler: event_handler_t, userdata: *mut c_void, repeat: bool) -> u64 {
+        if has_userdata() { ((*super::HOST).schedule)(ms, handler, userdata, repeat) } else { 0 }
+    }
+
+    // One instance per closure type: the host calls straight into F, no boxing of the call
+    extern "C" fn closure_trampoline<F: FnMut(&CStr, &CStr)>(userdata: *mut c_void, evt: *const c_char, payload: *const c_char) {
+        let f = unsafe { &mut *(userdata as *mut F) };
+        let empty = unsafe { CStr::from_bytes_with_nul_unchecked(b"\0") };
+        let payload = if payload.is_null() { empty } else { unsafe { CStr::from_ptr(payload) } };
+        f(unsafe { CStr::from_ptr(evt) }, payload);
+    }
+
+    /// A closure registered with the host. Dropping it unsubscribes or cancels, then frees the closure
+    pub struct Subscription<F> {
+        id: u64,
+        timer: bool,
+        closure: *mut F,
+    }
+
+    impl<F> Subscription<F> {
+        pub fn id(&self) -> u64 { self.id }
+    }
+
+    impl<F> Drop for Subscription<F> {
+        fn drop(&mut self) {
+            unsafe {
+                if !super::HOST.is_null() {
+                    if self.timer { ((*super::HOST).cancel_timer)(self.id); } else { unsubscribe(self.id); }
+                }
+                drop(Box::from_raw(self.closure));
+            }
+        }
+    }
+
+    /// Calls f(event, payload) for every event with this name while the Subscription lives
+    pub fn subscribe<F: FnMut(&CStr, &CStr) + 'static>(event: &CStr, f: F) -> Option<Subscription<F>> {
+        let closure = Box::into_raw(Box::new(f));
+        let id = unsafe { subscribe_raw(event.as_ptr(), closure_trampoline::<F>, closure as *mut c_void) };
+        if id == 0 {
+            unsafe { drop(Box::from_raw(closure)) };
+            return None;
+        }
+        Some(Subscription { id, timer: false, closure })
+    }
+
+    /// Calls f("timer", "") after ms, every ms with repeat, while the Subscription lives
+    pub fn schedule<F: FnMut(&CStr, &CStr) + 'static>(ms: u32, repeat: bool, f: F) -> Option<Subscription<F>> {
+        let closure = Box::into_raw(Box::new(f));
+        let id = unsafe { schedule_raw(ms, closure_trampoline::<F>, closure as *mut c_void, repeat) };
+        if id == 0 {
+            unsafe { drop(Box::from_raw(closure)) };
+            return None;
+        }
+        Some(Subscription { id, timer: true, closure })
+    }
+
+    fn has_batch() -> bool {
+        host_has!(register_events) && unsafe { (*super::HOST).features & HOST_FEATURE_BATCH != 0 }
+    }
+
+    /* Batched calls: one FFI crossing per slice, per item on older hosts */
+
+    pub fn send_batch(events: &[HostEvent]) {
+        unsafe {
+            if super::HOST.is_null() { return; }
+            let host = &*super::HOST;
+            if has_batch() {
+                (host.send_events)(events.as_ptr() as *const HostEvent<'static>, events.len() as u32);
+            } else {
+                for e in events { (host.send_event)(e.name, e.payload); }
+            }
+        }
+    }
+
+    pub fn store_batch(items: &[HostKeyValue]) -> u32 {
+        unsafe {
+            if super::HOST.is_null() { return 0; }
+            let host = &*super::HOST;
+            if has_batch() {
+                (host.set_data_many)(items.as_ptr() as *const HostKeyValue<'static>, items.len() as u32)
+            } else {
+                items.iter().filter(|kv| (host.set_data)(kv.key, kv.value)).count() as u32
+            }
+        }
+    }
+
+    pub fn load_batch(items: &mut [HostKeyValue]) -> u32 {
+        unsafe {
+            if super::HOST.is_null() { return 0; }
+            let host = &*super::HOST;
+            if has_batch() {
+                (host.get_data_many)(items.as_mut_ptr() as *mut HostKeyValue<'static>, items.len() as u32)
+            } else {
+                let mut found = 0;
+                for kv in items.iter_mut() {
+                    kv.value = (host.get_data)(kv.key);
+                    if !kv.value.is_null() { found += 1; }
+                }
+                found
+            }
+        }
+    }
+
+    pub fn on_batch(handlers: &[HostHandler]) {
+        unsafe {
+            if super::HOST.is_null() { return; }
+            let host = &*super::HOST;
+            if has_batch() {
+                (host.register_events)(handlers.as_ptr() as *const HostHandler<'static>, handlers.len() as u32);
+            } else {
+                for h in handlers { (host.register_event)(h.event_name, h.callback); }
+            }
+        }
+    }
 }
@@ -0,0 +1,81 @@
+// Measures per-item cost of single host calls against the batched ones.
+// Build with `./compile.sh bench`, add `Bench=batch_bench.so` to plugins.ini
+// and start the runtime; results are logged once the plugin initializes.
+#include "../plugin_api.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+start();
+
+static const uint32_t ITEMS = 1000;
+static const int ROUNDS = 200;
+
+event_handler(onBenchEvent) {}
+
+template <typename F>
+static double ns_per_item(F&& body) {
+    auto begin = std::chrono::steady_clock::now();
+    for (int r = 0; r < ROUNDS; r++) body();
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+    return elapsed / (double(ROUNDS) * ITEMS);
+}
+
+static void report(const char* what, double single, double batched) {
+    std::string line = std::string(what) + ": " + std::to_string(single) + " ns/item single, " +
+                       std::to_string(batched) + " ns/item batched (" +
+                       std::to_string(batched > 0 ? single / batched : 0.0) + "x)";
+    plugin::info(line.c_str());
+}
+
+static void run() {
+    std::vector<std::string> keys, values;
+    for (uint32_t i = 0; i < ITEMS; i++) {
+        keys.push_back("bench.key." + std::to_string(i));
+        values.push_back(std::to_string(i));
+    }
+
+    std::vector<HostKeyValue> items(ITEMS);
+    std::vector<HostEvent> events(ITEMS);
+    for (uint32_t i = 0; i < ITEMS; i++) {
+        items[i] = {keys[i].c_str(), values[i].c_str()};
+        events[i] = {"benchEvent", values[i].c_str()};
+    }
+
+    double setSingle = ns_per_item([&] {
+        for (uint32_t i = 0; i < ITEMS; i++) plugin::host->set_data(items[i].key, items[i].value);
+    });
+    double setBatch = ns_per_item([&] { plugin::host->set_data_many(items.data(), ITEMS); });
+    report("set_data", setSingle, setBatch);
+
+    double getSingle = ns_per_item([&] {
+        for (uint32_t i = 0; i < ITEMS; i++) items[i].value = plugin::host->get_data(items[i].key);
+    });
+    double getBatch = ns_per_item([&] { plugin::host->get_data_many(items.data(), ITEMS); });
+    report("get_data", getSingle, getBatch);
+
+    double sendSingle = ns_per_item([&] {
+        for (uint32_t i = 0; i < ITEMS; i++) plugin::host->send_event(events[i].name, events[i].payload);
+    });
+    double sendBatch = ns_per_item([&] { plugin::host->send_events(events.data(), ITEMS); });
+    report("send_event", sendSingle, sendBatch);
+
+    for (uint32_t i = 0; i < ITEMS; i++) plugin::host->delete_data(keys[i].c_str());
+}
+
+manifest("batch_bench", "1.0.0")
+
+api bool plugin_init(PluginHost* host) {
+    sethost();
+    if (!plugin::has_feature(HOST_FEATURE_BATCH)) {
+        plugin::warn("batch_bench: host has no batched calls");
+        return true;
+    }
+    plugin::on("benchEvent", onBenchEvent);
+    run();
+    return true;
+}
+
+api void plugin_shutdown() {
+    plugin::off(onBenchEvent);
+}
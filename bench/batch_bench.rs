@@ -0,0 +1,95 @@
+// batch_bench.cc through the Rust binding: per-item cost of api.rs's single
+// calls against its batched helpers, from a Rust plugin the runtime dlopens.
+// Built by `./compile.sh bench` (needs rustc), add `BenchRs=batch_bench_rs.so`
+// to plugins.ini and start the runtime; results are logged at plugin_init.
+
+#[path = "../api_supports/api.rs"]
+mod api;
+use api::*;
+
+use std::ffi::{c_char, CStr, CString};
+use std::ptr;
+use std::time::Instant;
+
+const ITEMS: usize = 1000;
+const ROUNDS: usize = 200;
+
+extern "C" fn on_bench_event(_name: *const c_char, _payload: *const c_char) {}
+
+fn ns_per_item(mut body: impl FnMut()) -> f64 {
+    let begin = Instant::now();
+    for _ in 0..ROUNDS { body(); }
+    begin.elapsed().as_nanos() as f64 / (ROUNDS * ITEMS) as f64
+}
+
+fn report(what: &str, single: f64, batched: f64) {
+    let ratio = if batched > 0.0 { single / batched } else { 0.0 };
+    let line = CString::new(format!("batch_bench_rs {}: {:.2} ns/item single, {:.2} ns/item batched ({:.2}x)",
+                                    what, single, batched, ratio)).unwrap();
+    unsafe { plugin::log(c"INFO".as_ptr(), line.as_ptr()); }
+}
+
+fn run() {
+    let keys: Vec<CString> = (0..ITEMS).map(|i| CString::new(format!("bench.rs.key.{}", i)).unwrap()).collect();
+    let values: Vec<CString> = (0..ITEMS).map(|i| CString::new(i.to_string()).unwrap()).collect();
+    let event: &CStr = c"benchEvent";
+
+    let items: Vec<HostKeyValue> = (0..ITEMS).map(|i| HostKeyValue::new(&keys[i], &values[i])).collect();
+    let mut lookups: Vec<HostKeyValue> = keys.iter().map(|k| HostKeyValue::key(k)).collect();
+    let events: Vec<HostEvent> = values.iter().map(|v| HostEvent::new(event, v)).collect();
+
+    let set_single = ns_per_item(|| for kv in &items { unsafe { plugin::store(kv.key, kv.value); } });
+    let set_batch = ns_per_item(|| { plugin::store_batch(&items); });
+    report("set_data", set_single, set_batch);
+
+    let mut sink: *const c_char = ptr::null();
+    let get_single = ns_per_item(|| for kv in &items { sink = unsafe { plugin::load(kv.key) }; });
+    let get_batch = ns_per_item(|| { plugin::load_batch(&mut lookups); });
+    std::hint::black_box(sink);
+    report("get_data", get_single, get_batch);
+
+    let send_single = ns_per_item(|| for e in &events { unsafe { plugin::send(e.name, e.payload); } });
+    let send_batch = ns_per_item(|| plugin::send_batch(&events));
+    report("send_event", send_single, send_batch);
+
+    unsafe {
+        let host = &*HOST;
+        for k in &keys { (host.delete_data)(k.as_ptr()); }
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn plugin_init(host: *mut PluginHost) -> bool {
+    unsafe {
+        api::HOST = host;
+        if (*host).features & HOST_FEATURE_BATCH == 0 {
+            plugin::log(c"WARN".as_ptr(), c"batch_bench_rs: host has no batched calls".as_ptr());
+            return true;
+        }
+        plugin::on(c"benchEvent".as_ptr(), on_bench_event);
+    }
+    run();
+    true
+}
+
+#[no_mangle]
+pub extern "C" fn plugin_shutdown() {
+    unsafe { plugin::off(on_bench_event); }
+}
+
+static mut INFO: PluginInfoV2 = PluginInfoV2 {
+    name: b"batch_bench_rs\0".as_ptr() as _,
+    version: b"1.0.0\0".as_ptr() as _,
+    abi_version: ABI_V2,
+    priority: PRIORITY_DEFAULT,
+    _pad: [0; 3],
+    descriptor_count: 0,
+    descriptors: ptr::null(),
+    features: 0,
+    host_table_size: core::mem::size_of::<PluginHost>() as u32,
+};
+
+#[no_mangle]
+pub extern "C" fn plugin_get_info() -> *const PluginInfo {
+    ptr::addr_of!(INFO) as *const PluginInfo
+}
@@ -0,0 +1,64 @@
+// Measures the cost of crossing the plugin boundary in either build mode.
+// Dynamic: `./compile.sh bench` and add `Bench=dispatch_bench.so` to plugins.ini.
+// Static: `./compile.sh static console dispatch_bench` and start runtime_static
+// with the same plugins.ini. Results are logged once the plugin initializes.
+#include "../plugin_api.h"
+#include <chrono>
+#include <string>
+
+start();
+
+static const uint32_t CALLS = 100000;
+static uint32_t received = 0;
+
+event_handler(onDispatchBench) {
+    received++;
+}
+
+template <typename F>
+static double ns_per_call(F&& body) {
+    auto begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < CALLS; i++) body(i);
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+    return elapsed / CALLS;
+}
+
+#ifdef PLUGIN_STATIC
+static const char* MODE = "static";
+#else
+static const char* MODE = "dynamic";
+#endif
+
+static void report(const char* what, double ns) {
+    std::string line = std::string("dispatch_bench (") + MODE + ") " + what + ": " + std::to_string(ns) + " ns/call";
+    plugin::info(line.c_str());
+}
+
+static void run() {
+    plugin::store("dispatch.bench", "1");
+
+    // Plugin to host and back, no event bus work
+    report("has_data", ns_per_call([](uint32_t) { plugin::host->has_data("dispatch.bench"); }));
+    report("get_data", ns_per_call([](uint32_t) { plugin::host->get_data("dispatch.bench"); }));
+
+    // Plugin to host to the event bus and back into a plugin handler
+    received = 0;
+    double send = ns_per_call([](uint32_t) { plugin::send("dispatchBench", ""); });
+    if (received != CALLS) plugin::warn("dispatch_bench: handler missed events");
+    report("send_event", send);
+
+    plugin::host->delete_data("dispatch.bench");
+}
+
+manifest("dispatch_bench", "1.0.0")
+
+api bool plugin_init(PluginHost* host) {
+    sethost();
+    plugin::on("dispatchBench", onDispatchBench);
+    run();
+    return true;
+}
+
+api void plugin_shutdown() {
+    plugin::off(onDispatchBench);
+}
@@ -0,0 +1,81 @@
+// Synthetic plugin for tools/scale_harness, which copies it to N files and
+// loads them all. Each copy takes a distinct index from a host counter and
+// reads its load from the environment the harness starts the runtime with:
+//   SCALE_LISTENERS  handlers per plugin: one on tick, the rest on shared topics (4)
+//   SCALE_TOPICS     shared topics the other handlers spread over (16)
+//   SCALE_TIMERS     repeating timers per plugin, 16 to 112 ms apart (1)
+//   SCALE_KEYS       storage keys written per tick (2)
+//   SCALE_WORK_US    busy time per handler call, in microseconds (0)
+// Every tick a plugin writes its keys and sends one event on its own topic.
+#include "../plugin_api.h"
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+start();
+
+static uint32_t setting(const char* name, uint32_t fallback) {
+    const char* value = getenv(name);
+    return value && *value ? (uint32_t)strtoul(value, nullptr, 10) : fallback;
+}
+
+static int64_t index_ = 0;
+static uint32_t keys = 2;
+static uint32_t workUs = 0;
+static std::string topic;
+static std::vector<std::string> keyNames;
+static std::vector<uint64_t> timerIds;
+
+static void work() {
+    if (!workUs) return;
+    auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(workUs);
+    while (std::chrono::steady_clock::now() < until) {}
+}
+
+event_handler(onScaleTick) {
+    for (uint32_t i = 0; i < keys; i++) plugin::store(keyNames[i].c_str(), payload);
+    plugin::send(topic.c_str(), "scale");
+    work();
+}
+
+event_handler(onScaleTopic) {
+    work();
+}
+
+event_handler(onScaleTimer) {
+    work();
+}
+
+manifest("scale_plugin", "1.0.0")
+
+api bool plugin_init(PluginHost* host) {
+    sethost();
+    if (!plugin::has_feature(HOST_FEATURE_TYPED_DATA)) return false;
+
+    index_ = plugin::add("scale.next", (int64_t)1);
+    uint32_t listeners = setting("SCALE_LISTENERS", 4);
+    uint32_t topics = setting("SCALE_TOPICS", 16);
+    uint32_t timers = setting("SCALE_TIMERS", 1);
+    keys = setting("SCALE_KEYS", 2);
+    workUs = setting("SCALE_WORK_US", 0);
+    if (topics == 0) topics = 1;
+
+    topic = "scale.topic." + std::to_string(index_ % topics);
+    for (uint32_t i = 0; i < keys; i++) keyNames.push_back("scale." + std::to_string(index_) + "." + std::to_string(i));
+
+    if (listeners > 0) plugin::on("tick", onScaleTick);
+    for (uint32_t i = 1; i < listeners; i++) {
+        plugin::on(("scale.topic." + std::to_string((index_ + i) % topics)).c_str(), onScaleTopic);
+    }
+    for (uint32_t i = 0; i < timers; i++) {
+        timerIds.push_back(plugin::timer(16 + (uint32_t)((index_ + i) % 7) * 16, onScaleTimer, true));
+    }
+    return true;
+}
+
+api void plugin_shutdown() {
+    plugin::off(onScaleTick);
+    plugin::off(onScaleTopic);
+    for (uint64_t id : timerIds) plugin::host->cancel_timer(id);
+}
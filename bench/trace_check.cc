@@ -0,0 +1,39 @@
+// Timer-driven plugin for tools/trace_check.sh. A repeating timer sends
+// trace_check.ping and a handler counts what arrives; both counts are logged
+// at shutdown. Timers run again under --replay, so a trace that recorded their
+// pings as top-level would deliver each one twice and received would exceed sent.
+#include "../plugin_api.h"
+#include <string>
+
+start();
+
+static uint64_t sent = 0;
+static uint64_t received = 0;
+static uint64_t timerId = 0;
+
+event_handler(onTraceCheckTimer) {
+    sent++;
+    plugin::send("trace_check.ping", std::to_string(sent).c_str());
+}
+
+event_handler(onTraceCheckPing) {
+    received++;
+}
+
+manifest("trace_check", "1.0.0")
+
+api bool plugin_init(PluginHost* host) {
+    sethost();
+    plugin::on("trace_check.ping", onTraceCheckPing);
+    timerId = plugin::timer(50, onTraceCheckTimer, true);
+    return true;
+}
+
+api void plugin_shutdown() {
+    plugin::host->cancel_timer(timerId);
+    plugin::off(onTraceCheckPing);
+
+    std::string line = "[TraceCheck] sent " + std::to_string(sent) + " received " + std::to_string(received);
+    if (received == sent) plugin::info(line.c_str());
+    else plugin::error(line.c_str());
+}
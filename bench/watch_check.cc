@@ -0,0 +1,42 @@
+// Plugin for tools/watch_check.sh. It watches watch_check.key, loads
+// watch_check_peer.so, which watches the same key after it, and then writes
+// the key. Its own watch callback unloads the peer, so the peer's callback in
+// the same flush must be skipped rather than called into an unloaded library.
+#include "../plugin_api.h"
+#include <string>
+
+start();
+
+static uint64_t timerId = 0;
+static bool peerUnloaded = false;
+
+event_handler(onWatchCheckKey) {
+    peerUnloaded = plugin::host->unload_plugin("watch_check_peer.so");
+}
+
+event_handler(onWatchCheckTimer) {
+    plugin::watch("watch_check.key", onWatchCheckKey);
+    if (!plugin::host->load_plugin("watch_check_peer.so")) {
+        plugin::error("[WatchCheck] could not load watch_check_peer.so");
+        return;
+    }
+    plugin::store("watch_check.key", "1");
+}
+
+manifest("watch_check", "1.0.0")
+
+api bool plugin_init(PluginHost* host) {
+    sethost();
+    if (!plugin::has_feature(HOST_FEATURE_WATCH)) {
+        plugin::error("[WatchCheck] host has no watch_data");
+        return false;
+    }
+    timerId = plugin::timer(50, onWatchCheckTimer);
+    return true;
+}
+
+api void plugin_shutdown() {
+    plugin::host->cancel_timer(timerId);
+    if (peerUnloaded) plugin::info("[WatchCheck] peer unloaded by an earlier watcher");
+    else plugin::error("[WatchCheck] peer was not unloaded");
+}
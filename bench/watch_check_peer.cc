@@ -0,0 +1,19 @@
+// Second watcher for tools/watch_check.sh, loaded by watch_check.so. It is
+// unloaded before its callback is due, so reaching the callback is a failure.
+#include "../plugin_api.h"
+
+start();
+
+event_handler(onWatchCheckPeerKey) {
+    plugin::error("[WatchCheck] unloaded peer's watch was called");
+}
+
+manifest("watch_check_peer", "1.0.0")
+
+api bool plugin_init(PluginHost* host) {
+    sethost();
+    plugin::watch("watch_check.key", onWatchCheckPeerKey);
+    return true;
+}
+
+api void plugin_shutdown() {}
@@ -0,0 +1,259 @@
+#include "budget.h"
+#include "log.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+BudgetMonitor BUDGETS;
+
+uint64_t budget_now_ns() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string format_ms(uint64_t ns) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.2f ms", ns / 1e6);
+    return text;
+}
+
+// ================= Watchdog slots =================
+
+// What a thread is running right now, read by the watchdog under a spin lock
+struct CallbackSlot {
+    std::atomic_flag busy = ATOMIC_FLAG_INIT;
+    uint64_t startNs = 0; // 0 while idle
+    PluginBudget* budget = nullptr;
+    char what[64] = {};
+    uint64_t reportedStartNs = 0; // Watchdog only
+
+    void set(PluginBudget* b, const char* w, uint64_t start) {
+        while (busy.test_and_set(std::memory_order_acquire)) {}
+        budget = b;
+        startNs = start;
+        snprintf(what, sizeof(what), "%s", w ? w : "");
+        busy.clear(std::memory_order_release);
+    }
+};
+
+static std::mutex SLOTS_LOCK;
+static std::vector<CallbackSlot*> SLOTS;
+
+struct ThreadSlot {
+    CallbackSlot slot;
+    ThreadSlot() {
+        std::lock_guard<std::mutex> guard(SLOTS_LOCK);
+        SLOTS.push_back(&slot);
+    }
+    ~ThreadSlot() {
+        std::lock_guard<std::mutex> guard(SLOTS_LOCK);
+        SLOTS.erase(std::remove(SLOTS.begin(), SLOTS.end(), &slot), SLOTS.end());
+    }
+};
+
+static CallbackSlot& thread_slot() {
+    thread_local ThreadSlot holder;
+    return holder.slot;
+}
+
+static thread_local BudgetScope* CURRENT_SCOPE = nullptr;
+
+// ================= Scope =================
+
+BudgetScope::BudgetScope(PluginBudget* b, const char* w, bool enforceBudget) {
+    if (!BUDGETS.enabled || !b) return;
+    active = true;
+    enforce = enforceBudget;
+    budget = b;
+    what = w;
+
+    outer = CURRENT_SCOPE;
+    CURRENT_SCOPE = this;
+
+    startNs = budget_now_ns();
+    thread_slot().set(budget, what, startNs);
+}
+
+BudgetScope::~BudgetScope() {
+    if (!active) return;
+    uint64_t elapsed = budget_now_ns() - startNs;
+
+    // The watchdog sees the outer callback as started later by the time spent here
+    CURRENT_SCOPE = outer;
+    if (outer) {
+        outer->nestedNs += elapsed;
+        thread_slot().set(outer->budget, outer->what, outer->startNs + outer->nestedNs);
+    } else {
+        thread_slot().set(nullptr, nullptr, 0);
+    }
+
+    BUDGETS.finish(budget, what, elapsed - nestedNs, enforce);
+}
+
+// ================= Monitor =================
+
+void BudgetMonitor::configure(const std::vector<std::string>& entries) {
+    for (const auto& entry : entries) {
+        size_t eq_pos = entry.find('=');
+        if (eq_pos == std::string::npos) continue;
+
+        std::string key = entry.substr(0, eq_pos);
+        std::string value = entry.substr(eq_pos + 1);
+        enabled = true;
+
+        try {
+            if (key == "callback_ms") defaultLimitNs = (uint64_t)(std::stod(value) * 1e6);
+            else if (key == "strikes") strikes = (uint32_t)std::stoul(value);
+            else if (key == "hang_ms") hangNs = (uint64_t)(std::stod(value) * 1e6);
+            else if (key == "defer_ms") deferNs = (uint64_t)(std::stod(value) * 1e6);
+            else if (key == "max_deferred") maxDeferred = (size_t)std::stoul(value);
+            else if (key == "critical") {
+                criticalEvents.clear();
+                size_t begin = 0;
+                while (begin <= value.size()) {
+                    size_t comma = value.find(',', begin);
+                    if (comma == std::string::npos) comma = value.size();
+                    if (comma > begin) criticalEvents.insert(value.substr(begin, comma - begin));
+                    begin = comma + 1;
+                }
+            }
+            else limits[key] = (uint64_t)(std::stod(value) * 1e6);
+        } catch (...) {
+            log_warn("[Budget] Ignoring invalid entry: " + entry);
+        }
+    }
+}
+
+PluginBudget* BudgetMonitor::budget(const std::string& name) {
+    std::lock_guard<std::mutex> guard(budgetsLock);
+    auto it = budgets.find(name);
+    if (it != budgets.end()) return it->second.get();
+
+    auto b = std::make_unique<PluginBudget>();
+    b->name = name;
+    auto limit = limits.find(name);
+    b->limitNs = limit != limits.end() ? limit->second : defaultLimitNs;
+    return budgets.emplace(name, std::move(b)).first->second.get();
+}
+
+bool BudgetMonitor::critical(const char* eventName) const {
+    return criticalEvents.count(eventName) > 0;
+}
+
+void BudgetMonitor::finish(PluginBudget* b, const char* what, uint64_t elapsedNs, bool enforce) {
+    b->calls.fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t worst = b->worstNs.load(std::memory_order_relaxed);
+    while (elapsedNs > worst && !b->worstNs.compare_exchange_weak(worst, elapsedNs)) {}
+
+    if (elapsedNs > hangNs) {
+        log_warn("[Watchdog] " + b->name + " returned from '" + (what ? what : "") + "' after " + format_ms(elapsedNs));
+    }
+
+    if (!enforce || b->limitNs == 0 || elapsedNs <= b->limitNs) return;
+    b->overruns.fetch_add(1, std::memory_order_relaxed);
+    b->windowOverruns.fetch_add(1, std::memory_order_relaxed);
+
+    // At most one line per plugin per second, the report has the totals
+    uint64_t now = budget_now_ns();
+    uint64_t last = b->lastLogNs.load(std::memory_order_relaxed);
+    if (now - last >= 1000000000ull && b->lastLogNs.compare_exchange_strong(last, now)) {
+        log_warn("[Budget] " + b->name + " overran its " + format_ms(b->limitNs) + " budget in '" +
+                 (what ? what : "") + "': " + format_ms(elapsedNs));
+    }
+}
+
+void BudgetMonitor::review() {
+    if (!enabled) return;
+    uint64_t now = budget_now_ns();
+    if (windowStartNs == 0) windowStartNs = now;
+    if (now - windowStartNs < 1000000000ull) return;
+    windowStartNs = now;
+
+    std::lock_guard<std::mutex> guard(budgetsLock);
+    for (auto& pair : budgets) {
+        PluginBudget& b = *pair.second;
+        bool over = b.windowOverruns.exchange(0, std::memory_order_relaxed) >= strikes;
+        if (over == b.deprioritized.load(std::memory_order_relaxed)) continue;
+
+        b.deprioritized = over;
+        if (over) log_warn("[Budget] " + b.name + " keeps overrunning, deferring its non-critical events");
+        else log_info("[Budget] " + b.name + " is back within budget");
+    }
+}
+
+std::string BudgetMonitor::report() const {
+    std::lock_guard<std::mutex> guard(budgetsLock);
+    std::vector<const PluginBudget*> sorted;
+    for (const auto& pair : budgets) sorted.push_back(pair.second.get());
+    std::sort(sorted.begin(), sorted.end(),
+        [](const PluginBudget* a, const PluginBudget* b) { return a->name < b->name; });
+
+    std::string out;
+    for (const PluginBudget* b : sorted) {
+        if (b->calls == 0) continue;
+        out += b->name + " budget " + (b->limitNs ? format_ms(b->limitNs) : std::string("-")) +
+               " calls " + std::to_string(b->calls.load()) +
+               " overruns " + std::to_string(b->overruns.load()) +
+               " worst " + format_ms(b->worstNs.load()) +
+               (b->deprioritized ? " [deferred]" : "") + "\n";
+    }
+    return out;
+}
+
+void BudgetMonitor::metrics(std::vector<MetricSample>& out) const {
+    std::lock_guard<std::mutex> guard(budgetsLock);
+    std::vector<const PluginBudget*> sorted;
+    for (const auto& pair : budgets) sorted.push_back(pair.second.get());
+    std::sort(sorted.begin(), sorted.end(),
+        [](const PluginBudget* a, const PluginBudget* b) { return a->name < b->name; });
+
+    for (const PluginBudget* b : sorted) {
+        out.push_back({metric_key("runtime_callbacks_total", "plugin", b->name), METRIC_COUNTER, (double)b->calls.load()});
+        out.push_back({metric_key("runtime_callback_overruns_total", "plugin", b->name), METRIC_COUNTER, (double)b->overruns.load()});
+        out.push_back({metric_key("runtime_callback_worst_seconds", "plugin", b->name), METRIC_GAUGE, b->worstNs.load() / 1e9});
+        out.push_back({metric_key("runtime_plugin_deferred", "plugin", b->name), METRIC_GAUGE, b->deprioritized ? 1.0 : 0.0});
+    }
+}
+
+// ================= Watchdog =================
+
+void BudgetMonitor::open() {
+    if (!enabled || running.exchange(true)) return;
+    watchdog = std::thread(&BudgetMonitor::watchdog_loop, this);
+}
+
+void BudgetMonitor::close() {
+    if (running.exchange(false)) {
+        wake.notify_one();
+        watchdog.join();
+    }
+}
+
+void BudgetMonitor::watchdog_loop() {
+    // Checks often enough to report a hang within a quarter of hang_ms
+    auto period = std::chrono::nanoseconds(std::clamp<uint64_t>(hangNs / 4, 10000000ull, 250000000ull));
+
+    while (running) {
+        {
+            std::unique_lock<std::mutex> guard(wakeLock);
+            wake.wait_for(guard, period);
+        }
+        if (!running) break;
+
+        uint64_t now = budget_now_ns();
+        std::lock_guard<std::mutex> guard(SLOTS_LOCK);
+        for (CallbackSlot* slot : SLOTS) {
+            while (slot->busy.test_and_set(std::memory_order_acquire)) {}
+            uint64_t start = slot->startNs;
+            PluginBudget* b = slot->budget;
+            std::string what = slot->what;
+            slot->busy.clear(std::memory_order_release);
+
+            if (!b || start == 0 || now - start < hangNs || slot->reportedStartNs == start) continue;
+            slot->reportedStartNs = start;
+            log_warn("[Watchdog] " + b->name + " has been running '" + what + "' for " + format_ms(now - start));
+        }
+    }
+}
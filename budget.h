@@ -0,0 +1,110 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "metrics.h"
+
+// Per-plugin CPU budgets
+//
+// With a [BUDGETS] section in plugins.ini every plugin callback (event
+// handlers, typed events, timers, storage watches) is timed against its
+// plugin's budget. Overruns are logged with the event name; a plugin that
+// overruns `strikes` times within a second has its non-critical events
+// deferred to later frames until it behaves for a whole second. A watchdog
+// thread reports callbacks that have not returned after hang_ms.
+//
+// Without the section nothing is timed and BudgetScope is a single branch.
+
+struct PluginBudget {
+    std::string name;
+    uint64_t limitNs = 0; // 0 for no budget
+
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> overruns{0};
+    std::atomic<uint64_t> worstNs{0};
+    std::atomic<uint32_t> windowOverruns{0};
+    std::atomic<bool> deprioritized{false};
+    std::atomic<uint64_t> lastLogNs{0};
+};
+
+class BudgetMonitor {
+public:
+    bool enabled = false;
+
+    // [BUDGETS] entries: callback_ms, strikes, hang_ms, defer_ms, max_deferred,
+    // critical=<event,event>, anything else is <plugin>=<ms>
+    void configure(const std::vector<std::string>& entries);
+
+    // Owned by the monitor, valid for the whole run
+    PluginBudget* budget(const std::string& name);
+
+    // Critical events are never deferred
+    bool critical(const char* eventName) const;
+
+    // Called once per frame, re-evaluates who is deprioritized every second
+    void review();
+
+    void open();
+    void close();
+
+    // One line per plugin: calls, overruns, worst callback, state
+    std::string report() const;
+
+    // Calls, overruns and worst callback per plugin, for the metrics page
+    void metrics(std::vector<MetricSample>& out) const;
+
+    void finish(PluginBudget* budget, const char* what, uint64_t elapsedNs, bool enforce);
+
+    uint64_t deferNs = 4000000;
+    size_t maxDeferred = 1024;
+
+private:
+    void watchdog_loop();
+
+    uint64_t defaultLimitNs = 0;
+    uint32_t strikes = 5;
+    uint64_t hangNs = 1000000000;
+    std::unordered_map<std::string, uint64_t> limits;
+    std::unordered_set<std::string> criticalEvents = {"consoleInput"};
+
+    mutable std::mutex budgetsLock;
+    std::unordered_map<std::string, std::unique_ptr<PluginBudget>> budgets;
+    uint64_t windowStartNs = 0;
+
+    std::thread watchdog;
+    std::atomic<bool> running{false};
+    std::mutex wakeLock;
+    std::condition_variable wake;
+};
+
+extern BudgetMonitor BUDGETS;
+
+// Times one callback, nested scopes restore the outer callback for the watchdog.
+// Time spent in a nested scope is charged to it and not to the outer one, so a
+// handler is not blamed for the slow handlers of the events it sends
+struct BudgetScope {
+    BudgetScope(PluginBudget* budget, const char* what, bool enforce = true);
+    ~BudgetScope();
+
+    BudgetScope(const BudgetScope&) = delete;
+    BudgetScope& operator=(const BudgetScope&) = delete;
+
+private:
+    bool active = false;
+    bool enforce = true;
+    PluginBudget* budget = nullptr;
+    const char* what = nullptr;
+    uint64_t startNs = 0;
+    uint64_t nestedNs = 0; // Spent in scopes nested inside this one
+
+    BudgetScope* outer = nullptr; // Still running further up this thread's stack
+};
+
+uint64_t budget_now_ns();
@@ -0,0 +1,74 @@
+#include "clock.h"
+#include "ABI_compat_layer.h"
+#include <algorithm>
+#include <cstdio>
+
+Clock CLOCK;
+
+bool Clock::set_virtual(const std::string& spec) {
+    if (spec == "next") {
+        mode = VIRTUAL_NEXT;
+    } else {
+        duration length;
+        if (!parse_duration(spec, length) || length <= duration::zero()) return false;
+        mode = VIRTUAL_STEP;
+        step = length;
+    }
+    // Starts at the real time, so time points taken before stay comparable
+    origin = std::chrono::steady_clock::now();
+    current.store(origin.time_since_epoch().count(), std::memory_order_relaxed);
+    return true;
+}
+
+uint64_t Clock::now_ms() const {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(now().time_since_epoch()).count();
+}
+
+void Clock::next_frame(const time_point* nextDeadline) {
+    if (mode == REAL) {
+        PLATFORM_SLEEP_MS(16);
+        return;
+    }
+
+    time_point at = now();
+    time_point target = at + step;
+    if (mode == VIRTUAL_NEXT && nextDeadline) {
+        // A 0 ms repeating timer would otherwise hold the clock still forever
+        target = std::max(*nextDeadline, at + std::chrono::milliseconds(1));
+    }
+    current.store(target.time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+bool parse_duration(const std::string& text, Clock::duration& out) {
+    size_t used = 0;
+    double value;
+    try {
+        value = std::stod(text, &used);
+    } catch (...) {
+        return false;
+    }
+    if (value < 0) return false;
+
+    std::string unit = text.substr(used);
+    double ms;
+    if (unit.empty() || unit == "ms") ms = value;
+    else if (unit == "s") ms = value * 1000.0;
+    else if (unit == "m") ms = value * 60000.0;
+    else if (unit == "h") ms = value * 3600000.0;
+    else if (unit == "d") ms = value * 86400000.0;
+    else return false;
+
+    out = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(ms));
+    return true;
+}
+
+std::string format_duration(Clock::duration d) {
+    uint64_t ms = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+    uint64_t days = ms / 86400000;
+    ms %= 86400000;
+
+    char text[48];
+    snprintf(text, sizeof(text), "%02u:%02u:%02u.%03u",
+             (unsigned)(ms / 3600000), (unsigned)(ms / 60000 % 60), (unsigned)(ms / 1000 % 60), (unsigned)(ms % 1000));
+    return days ? std::to_string(days) + "d " + text : std::string(text);
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Host clock
+//
+// Timers, storage TTLs, event traces and the clock_ms host call read time
+// from here. By default it is std::chrono::steady_clock and every frame
+// sleeps 16 ms. With --virtual the clock stands still while a frame runs and
+// the main loop moves it between frames, without sleeping: by a fixed step,
+// or straight to the next timer deadline. Timers due at the same instant
+// fire in the order they were set, so a virtual run is repeatable.
+//
+// CPU budgets, the watchdog, metrics intervals and plugins.ini polling stay
+// on real time, they are about the machine rather than the simulation.
+
+class Clock {
+public:
+    using time_point = std::chrono::steady_clock::time_point;
+    using duration = std::chrono::steady_clock::duration;
+
+    enum Mode { REAL, VIRTUAL_STEP, VIRTUAL_NEXT };
+
+    Mode mode = REAL;
+    duration step = std::chrono::milliseconds(16); // Frame length, the most VIRTUAL_NEXT moves without a deadline
+
+    // "<ms>" for fixed steps, "next" for deadline jumps. False on anything else
+    bool set_virtual(const std::string& spec);
+    bool is_virtual() const { return mode != REAL; }
+
+    time_point now() const {
+        return mode == REAL ? std::chrono::steady_clock::now()
+                            : time_point(duration(current.load(std::memory_order_relaxed)));
+    }
+    uint64_t now_ms() const;
+
+    // Time since the clock was created, or since set_virtual
+    duration elapsed() const { return now() - origin; }
+
+    // End of frame: sleeps for a frame in real time, otherwise moves the
+    // virtual clock by one step or to nextDeadline, at least 1 ms ahead
+    void next_frame(const time_point* nextDeadline);
+
+private:
+    time_point origin = std::chrono::steady_clock::now();
+    std::atomic<duration::rep> current{0}; // Virtual time, read from any thread
+};
+
+extern Clock CLOCK;
+
+// "500ms", "90s", "15m", "24h", "7d"; a bare number is milliseconds. False when malformed
+bool parse_duration(const std::string& text, Clock::duration& out);
+
+// "1d 02:03:04.005" style, for logs
+std::string format_duration(Clock::duration d);
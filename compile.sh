@@ -11,4 +11,39 @@ clang++ -shared -o python.so python.o ini.o -L"/lib/x86_64-linux-gnu/" -lpython3
 
 cd ..
 echo --- RUNTIME ---
-clang++ -o runtime runtime.cc ini.cc
\ No newline at end of file
+RUNTIME_SOURCES="runtime.cc ini.cc trace.cc log.cc plugin_index.cc storage.cc budget.cc memory.cc metrics.cc clock.cc"
+clang++ -std=c++20 -pthread -o runtime $RUNTIME_SOURCES
+
+echo --- TOOLS ---
+clang++ -std=c++20 -O2 -o metrics_export tools/metrics_export.cc
+if [ "$1" = "bench" ]; then
+    echo --- BENCH ---
+    clang++ -std=c++20 -O2 -fPIC -shared -o plugins/batch_bench.so bench/batch_bench.cc
+    if command -v rustc > /dev/null; then
+        rustc --edition 2021 -O --crate-type cdylib --cfg api_module -o plugins/batch_bench_rs.so bench/batch_bench.rs
+    fi
+    clang++ -std=c++20 -O2 -fPIC -shared -o plugins/dispatch_bench.so bench/dispatch_bench.cc
+    clang++ -std=c++20 -O2 -fPIC -shared -o plugins/scale_plugin.so bench/scale_plugin.cc
+    clang++ -std=c++20 -O2 -fPIC -shared -o plugins/trace_check.so bench/trace_check.cc
+    clang++ -std=c++20 -O2 -fPIC -shared -o plugins/watch_check.so bench/watch_check.cc
+    clang++ -std=c++20 -O2 -fPIC -shared -o plugins/watch_check_peer.so bench/watch_check_peer.cc
+    clang++ -std=c++20 -O2 -o scale_harness tools/scale_harness.cc
+    # Optimized like runtime_static so the two can be compared
+    clang++ -std=c++20 -O2 -flto -pthread -o runtime $RUNTIME_SOURCES
+fi
+
+# ./compile.sh static [plugin...]: runtime_static with the named plugins
+# (plugins/<name>.cc or bench/<name>.cc, console by default) linked in, LTO
+# across host and plugins. Other plugins still load from plugins/
+if [ "$1" = "static" ]; then
+    echo --- STATIC RUNTIME ---
+    shift
+    STATIC_OBJECTS=""
+    for name in ${@:-console}; do
+        source=plugins/$name.cc
+        [ -f "$source" ] || source=bench/$name.cc
+        clang++ -std=c++20 -O2 -flto -DPLUGIN_STATIC=$name -c "$source" -o plugins/$name.static.o
+        STATIC_OBJECTS="$STATIC_OBJECTS plugins/$name.static.o"
+    done
+    clang++ -std=c++20 -O2 -flto -pthread -o runtime_static $RUNTIME_SOURCES $STATIC_OBJECTS
+fi
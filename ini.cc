@@ -1,3 +1,5 @@
+#include "ini.h"
+#include <filesystem>
 #include <fstream>
 #include <string>
 #include <vector>
@@ -37,4 +39,16 @@ std::vector<std::string> parse_ini(const std::string& filename, const std::strin
         }
     }
     return entries;
-}
\ No newline at end of file
+}
+
+FileStamp file_stamp(const std::string& filename) {
+    FileStamp stamp;
+    std::error_code ec;
+    std::filesystem::directory_entry file(filename, ec);
+    if (ec || !file.is_regular_file(ec)) return stamp;
+
+    stamp.size = (uint64_t)file.file_size(ec);
+    stamp.mtime = (int64_t)file.last_write_time(ec).time_since_epoch().count();
+    stamp.exists = !ec;
+    return stamp;
+}
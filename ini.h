@@ -1,3 +1,19 @@
+#pragma once
+#include <cstdint>
 #include <vector>
 #include <string>
-std::vector<std::string> parse_ini(const std::string& filename, const std::string& section);
\ No newline at end of file
+std::vector<std::string> parse_ini(const std::string& filename, const std::string& section);
+
+// Size and modification time, all zero when the file is missing. One stat, cheap enough to poll
+struct FileStamp {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    bool exists = false;
+
+    bool operator==(const FileStamp& other) const {
+        return size == other.size && mtime == other.mtime && exists == other.exists;
+    }
+    bool operator!=(const FileStamp& other) const { return !(*this == other); }
+};
+
+FileStamp file_stamp(const std::string& filename);
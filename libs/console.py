@@ -23,6 +23,11 @@ def on_console_input(event, payload):
                 "  load <plugin.dll>\n"
                 "  unload <plugin.dll>\n"
                 "  list\n"
+                "  loglevel <plugin|*> <level>\n"
+                "  storage\n"
+                "  budget\n"
+                "  memory\n"
+                "  events\n"
                 "  help")
         return
 
@@ -44,8 +49,61 @@ def on_console_input(event, payload):
         host.unload_plugin(plugin_name)
         return
 
+    if token == "loglevel":
+        if len(tokens) < 3:
+            api.log("Usage: loglevel <plugin|*> <DEBUG|INFO|WARN|ERROR|OFF>", api.WARN)
+            return
+        api.send_event("setLogLevel", f"{tokens[1]} {tokens[2]}")
+        return
+
     if token == "list":
-        host.send("requestPluginList", "")
+        api.send_event("requestPluginList", "")
+        return
+
+    if token == "storage":
+        api.send_event("requestStorageUsage", "")
+        return
+
+    if token == "budget":
+        api.send_event("requestBudgetReport", "")
+        return
+
+    if token == "memory":
+        api.send_event("requestMemoryUsage", "")
+        return
+
+    if token == "events":
+        api.send_event("requestEventPolicies", "")
         return
 
     api.log(f"Unknown command: {token}", api.WARN)
+
+
+@api.on("pluginList")
+def on_plugin_list(event, payload):
+    lines = [line for line in payload.splitlines() if line]
+    api.log("[console] Plugins:\n" + "\n".join("  " + line for line in lines))
+
+
+@api.on("storageUsage")
+def on_storage_usage(event, payload):
+    lines = [line for line in payload.splitlines() if line]
+    api.log("[console] Storage:\n" + "\n".join("  " + line for line in lines))
+
+
+@api.on("budgetReport")
+def on_budget_report(event, payload):
+    lines = [line for line in payload.splitlines() if line]
+    api.log("[console] Budgets:\n" + "\n".join("  " + line for line in lines))
+
+
+@api.on("memoryUsage")
+def on_memory_usage(event, payload):
+    lines = [line for line in payload.splitlines() if line]
+    api.log("[console] Memory:\n" + "\n".join("  " + line for line in lines))
+
+
+@api.on("eventPolicies")
+def on_event_policies(event, payload):
+    lines = [line for line in payload.splitlines() if line]
+    api.log("[console] Event policies:\n" + "\n".join("  " + line for line in lines))
@@ -0,0 +1,279 @@
+#include "log.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+Logger LOGGER;
+LogSource* RUNTIME_LOG = LOGGER.source("runtime");
+
+static uint64_t now_ns() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static const char* level_name(int level) {
+    switch (level) {
+        case LOG_DEBUG: return "DEBUG";
+        case LOG_INFO: return "INFO";
+        case LOG_WARN: return "WARN";
+        case LOG_ERROR: return "ERROR";
+        default: return "OFF";
+    }
+}
+
+int log_level_from_string(const char* level) {
+    if (!level) return LOG_INFO;
+    std::string s(level);
+    for (auto& c : s) c = (char)toupper((unsigned char)c);
+    if (s == "DEBUG" || s == "TRACE") return LOG_DEBUG;
+    if (s == "WARN" || s == "WARNING") return LOG_WARN;
+    if (s == "ERROR" || s == "FATAL") return LOG_ERROR;
+    if (s == "OFF" || s == "NONE") return LOG_OFF;
+    return LOG_INFO;
+}
+
+static void copy_truncated(char* dst, size_t cap, const char* src) {
+    size_t len = src ? strlen(src) : 0;
+    if (len >= cap) {
+        len = cap - 1;
+        if (cap > 4) memcpy(dst + cap - 4, "...", 3);
+        memcpy(dst, src, cap - 4);
+    } else {
+        memcpy(dst, src, len);
+    }
+    dst[len] = '\0';
+}
+
+LogSource* Logger::source(const std::string& name) {
+    std::lock_guard<std::mutex> guard(sourcesLock);
+    auto it = sources.find(name);
+    if (it == sources.end()) {
+        it = sources.try_emplace(name).first;
+        it->second.name = name;
+        it->second.minLevel = defaultLevel;
+    }
+    return &it->second;
+}
+
+bool Logger::set_level(const std::string& sourceName, int level) {
+    if (sourceName == "*") {
+        std::lock_guard<std::mutex> guard(sourcesLock);
+        defaultLevel = level;
+        for (auto& pair : sources) pair.second.minLevel = level;
+        return true;
+    }
+    source(sourceName)->minLevel = level;
+    return true;
+}
+
+void Logger::configure(const std::vector<std::string>& entries) {
+    for (const auto& entry : entries) {
+        size_t eq_pos = entry.find('=');
+        if (eq_pos == std::string::npos) continue;
+
+        std::string key = entry.substr(0, eq_pos);
+        std::string value = entry.substr(eq_pos + 1);
+
+        try {
+            if (key == "level") set_level("*", log_level_from_string(value.c_str()));
+            else if (key == "rate") rateLimit = (uint32_t)std::stoul(value);
+            else if (key == "sink") open_sink(value);
+            else set_level(key, log_level_from_string(value.c_str()));
+        } catch (...) {
+            write(RUNTIME_LOG, LOG_WARN, "[Log] Ignoring invalid entry: " + entry);
+        }
+    }
+}
+
+bool Logger::open_sink(const std::string& spec) {
+    // json:<path> or binary:<path>
+    size_t colon = spec.find(':');
+    if (colon == std::string::npos) return false;
+
+    std::string type = spec.substr(0, colon);
+    std::string path = spec.substr(colon + 1);
+
+    int newType = type == "json" ? LOG_SINK_JSON : type == "binary" ? LOG_SINK_BINARY : LOG_SINK_NONE;
+    if (newType == LOG_SINK_NONE) {
+        write(RUNTIME_LOG, LOG_WARN, "[Log] Unknown sink type: " + type);
+        return false;
+    }
+
+    FILE* f = fopen(path.c_str(), newType == LOG_SINK_BINARY ? "ab" : "a");
+    if (!f) {
+        write(RUNTIME_LOG, LOG_WARN, "[Log] Could not open sink: " + path);
+        return false;
+    }
+
+    if (sink) fclose(sink);
+    sink = f;
+    sinkType = newType;
+    return true;
+}
+
+// ================= Producers =================
+
+bool Logger::allow(LogSource* src) {
+    if (rateLimit == 0) return true;
+
+    uint64_t window = now_ns() / 1000000000ull;
+    uint64_t current = src->window.load(std::memory_order_relaxed);
+    if (current != window && src->window.compare_exchange_strong(current, window)) {
+        src->windowCount = 0;
+        uint32_t suppressed = src->suppressed.exchange(0);
+        if (suppressed > 0) {
+            std::string summary = "[Log] Suppressed " + std::to_string(suppressed) +
+                                  " messages from " + src->name;
+            push(RUNTIME_LOG, LOG_WARN, level_name(LOG_WARN), summary.c_str());
+        }
+    }
+
+    if (src->windowCount.fetch_add(1, std::memory_order_relaxed) < rateLimit) return true;
+    src->suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void Logger::write(LogSource* src, const char* levelText, const char* message) {
+    int level = log_level_from_string(levelText);
+    if (level < src->minLevel.load(std::memory_order_relaxed)) return;
+    if (!allow(src)) return;
+    push(src, level, levelText, message);
+}
+
+void Logger::write(LogSource* src, int level, const std::string& message) {
+    if (level < src->minLevel.load(std::memory_order_relaxed)) return;
+    push(src, level, level_name(level), message.c_str());
+}
+
+Logger::Logger() {
+    ring = new Slot[LOG_RING_SLOTS];
+    for (size_t i = 0; i < LOG_RING_SLOTS; i++) {
+        ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool Logger::push(LogSource* src, int level, const char* levelText, const char* message) {
+    // Bounded multi-producer queue, each slot carries the position it expects next
+    uint64_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &ring[pos % LOG_RING_SLOTS];
+        uint64_t seq = slot->sequence.load(std::memory_order_acquire);
+        int64_t diff = (int64_t)seq - (int64_t)pos;
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->timestamp_ns = now_ns();
+    slot->src = src;
+    slot->level = level;
+    copy_truncated(slot->levelText, LOG_LEVEL_MAX, levelText);
+    copy_truncated(slot->message, LOG_MESSAGE_MAX, message);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
+    if (sleeping.load(std::memory_order_relaxed)) wake.notify_one();
+    return true;
+}
+
+// ================= Writer =================
+
+void Logger::open() {
+    if (running.exchange(true)) return;
+    writer = std::thread(&Logger::writer_loop, this);
+}
+
+void Logger::close() {
+    if (running.exchange(false)) {
+        wake.notify_one();
+        writer.join();
+    }
+    drain();
+    if (sink) {
+        fclose(sink);
+        sink = nullptr;
+    }
+}
+
+void Logger::writer_loop() {
+    while (running) {
+        drain();
+
+        std::unique_lock<std::mutex> guard(wakeLock);
+        sleeping = true;
+        wake.wait_for(guard, std::chrono::milliseconds(100));
+        sleeping = false;
+    }
+}
+
+void Logger::drain() {
+    bool wrote = false;
+    for (;;) {
+        Slot& slot = ring[dequeuePos % LOG_RING_SLOTS];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1) break;
+
+        emit(slot);
+        slot.sequence.store(dequeuePos + LOG_RING_SLOTS, std::memory_order_release);
+        dequeuePos++;
+        wrote = true;
+    }
+
+    uint64_t dropped = droppedCount.load(std::memory_order_relaxed);
+    if (dropped != reportedDropped) {
+        std::cerr << "[Log] Ring full, dropped " << (dropped - reportedDropped) << " messages\n";
+        reportedDropped = dropped;
+        wrote = true;
+    }
+
+    // One flush per batch instead of one per line
+    if (wrote) {
+        std::cout.flush();
+        std::cerr.flush();
+        if (sink) fflush(sink);
+    }
+}
+
+static void json_escape(FILE* f, const char* s) {
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') fprintf(f, "\\%c", c);
+        else if (c == '\n') fputs("\\n", f);
+        else if (c < 0x20) fprintf(f, "\\u%04x", c);
+        else fputc(c, f);
+    }
+}
+
+void Logger::emit(const Slot& slot) {
+    // Runtime messages carry their own [Component] prefix
+    std::ostream& out = slot.level >= LOG_ERROR ? std::cerr : std::cout;
+    if (slot.src == RUNTIME_LOG) out << slot.message << '\n';
+    else out << "[" << slot.levelText << "] " << slot.message << '\n';
+
+    if (sinkType == LOG_SINK_JSON) {
+        fprintf(sink, "{\"ts\":%llu,\"level\":\"", (unsigned long long)slot.timestamp_ns);
+        json_escape(sink, slot.levelText);
+        fputs("\",\"source\":\"", sink);
+        json_escape(sink, slot.src->name.c_str());
+        fputs("\",\"message\":\"", sink);
+        json_escape(sink, slot.message);
+        fputs("\"}\n", sink);
+    } else if (sinkType == LOG_SINK_BINARY) {
+        // u64 timestamp, u8 level, then u16 length prefixed source, level text and message
+        auto put_str = [this](const char* s) {
+            uint16_t len = (uint16_t)strlen(s);
+            fwrite(&len, sizeof(len), 1, sink);
+            fwrite(s, 1, len, sink);
+        };
+        uint8_t level = (uint8_t)slot.level;
+        fwrite(&slot.timestamp_ns, sizeof(slot.timestamp_ns), 1, sink);
+        fwrite(&level, sizeof(level), 1, sink);
+        put_str(slot.src->name.c_str());
+        put_str(slot.levelText);
+        put_str(slot.message);
+    }
+}
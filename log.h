@@ -0,0 +1,110 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Asynchronous logging
+//
+// Producers format into a fixed slot of a bounded lock-free ring and return.
+// A single writer thread drains the ring to the console and an optional file
+// sink. A full ring drops the message rather than stalling the caller.
+
+#define LOG_DEBUG 0
+#define LOG_INFO 1
+#define LOG_WARN 2
+#define LOG_ERROR 3
+#define LOG_OFF 4
+
+#define LOG_SINK_NONE 0
+#define LOG_SINK_JSON 1
+#define LOG_SINK_BINARY 2
+
+#define LOG_RING_SLOTS 4096
+#define LOG_MESSAGE_MAX 480
+#define LOG_LEVEL_MAX 16
+
+int log_level_from_string(const char* level);
+
+// One per plugin plus one for the runtime, addresses are stable
+struct LogSource {
+    std::string name;
+    std::atomic<int> minLevel{LOG_INFO};
+
+    // Fixed one second window rate limit
+    std::atomic<uint64_t> window{0};
+    std::atomic<uint32_t> windowCount{0};
+    std::atomic<uint32_t> suppressed{0};
+};
+
+class Logger {
+public:
+    Logger();
+    ~Logger() { close(); delete[] ring; }
+
+    void open();
+    void close();
+
+    // Reads the [LOGGING] section entries of plugins.ini
+    void configure(const std::vector<std::string>& entries);
+
+    LogSource* source(const std::string& name);
+    bool set_level(const std::string& sourceName, int level);
+
+    // levelText is kept as given so plugin defined levels still print
+    void write(LogSource* src, const char* levelText, const char* message);
+    void write(LogSource* src, int level, const std::string& message);
+
+    uint64_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+
+    int defaultLevel = LOG_INFO;
+    uint32_t rateLimit = 0; // Messages per second per source, 0 is unlimited
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> sequence;
+        uint64_t timestamp_ns;
+        LogSource* src;
+        int level;
+        char levelText[LOG_LEVEL_MAX];
+        char message[LOG_MESSAGE_MAX];
+    };
+
+    bool push(LogSource* src, int level, const char* levelText, const char* message);
+    bool allow(LogSource* src);
+    void writer_loop();
+    void drain();
+    void emit(const Slot& slot);
+    bool open_sink(const std::string& spec);
+
+    Slot* ring = nullptr;
+    std::atomic<uint64_t> enqueuePos{0};
+    uint64_t dequeuePos = 0;
+    std::atomic<uint64_t> droppedCount{0};
+    uint64_t reportedDropped = 0;
+
+    std::mutex sourcesLock;
+    std::unordered_map<std::string, LogSource> sources;
+
+    int sinkType = LOG_SINK_NONE;
+    FILE* sink = nullptr;
+
+    std::atomic<bool> running{false};
+    std::atomic<bool> sleeping{false};
+    std::mutex wakeLock;
+    std::condition_variable wake;
+    std::thread writer;
+};
+
+extern Logger LOGGER;
+extern LogSource* RUNTIME_LOG;
+
+// Runtime side helpers, messages are attributed to the runtime itself
+inline void log_info(const std::string& message) { LOGGER.write(RUNTIME_LOG, LOG_INFO, message); }
+inline void log_warn(const std::string& message) { LOGGER.write(RUNTIME_LOG, LOG_WARN, message); }
+inline void log_error(const std::string& message) { LOGGER.write(RUNTIME_LOG, LOG_ERROR, message); }
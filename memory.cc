@@ -0,0 +1,357 @@
+#include "memory.h"
+#include <algorithm>
+#include <cstring>
+
+Memory MEMORY;
+
+// In front of every allocation, free_memory finds the arena through it
+struct alignas(MEMORY_ALIGN) AllocHeader {
+    PluginArena* arena;
+    uint32_t sizeClass; // MEMORY_LARGE for allocations outside the slabs
+    uint32_t generation;
+};
+
+#define MEMORY_LARGE 0xFFFFFFFFu
+#define MEMORY_CACHE_BATCH 16 // Nodes moved between a thread cache and its arena at once
+#define MEMORY_CACHE_MAX 64   // Nodes a thread keeps per arena and class
+#define MEMORY_FRAME_MAX (64u << 20)
+#define MEMORY_FLUSH_OPS 256  // Allocations and frees a thread counts locally before publishing
+
+static int size_class(uint64_t size) {
+    for (int c = 0; c < MEMORY_SLAB_CLASSES; c++) {
+        if (size <= (uint64_t)MEMORY_SLAB_MIN << c) return c;
+    }
+    return -1;
+}
+
+static uint32_t class_size(int sizeClass) {
+    return (uint32_t)MEMORY_SLAB_MIN << sizeClass;
+}
+
+// ================= Thread caches =================
+
+struct MemoryThreadCache {
+    struct Entry {
+        PluginArena* arena = nullptr;
+        uint32_t generation = 0;
+        PluginArena::FreeNode* lists[MEMORY_SLAB_CLASSES] = {};
+        uint32_t counts[MEMORY_SLAB_CLASSES] = {};
+
+        // Published to the arena's atomics every MEMORY_FLUSH_OPS operations
+        int64_t pendingLive = 0;
+        uint32_t pendingAllocations = 0;
+        uint32_t pendingOps = 0;
+
+        void flush() {
+            if (pendingOps == 0) return;
+            arena->counted(pendingLive, pendingAllocations);
+            pendingLive = 0;
+            pendingAllocations = 0;
+            pendingOps = 0;
+        }
+
+        void note(int64_t bytes, uint32_t allocation) {
+            pendingLive += bytes;
+            pendingAllocations += allocation;
+            if (++pendingOps >= MEMORY_FLUSH_OPS) flush();
+        }
+    };
+    std::vector<Entry> entries; // By arena id
+
+    Entry& get(PluginArena* arena) {
+        if (arena->id >= entries.size()) entries.resize(arena->id + 1);
+        Entry& e = entries[arena->id];
+        uint32_t generation = arena->generation.load(std::memory_order_acquire);
+        // Whatever was cached before a release points into freed blocks, and
+        // what it counted was reset with the arena
+        if (e.arena != arena || e.generation != generation) {
+            e = Entry();
+            e.arena = arena;
+            e.generation = generation;
+        }
+        return e;
+    }
+
+    void flush() {
+        for (Entry& e : entries) {
+            if (e.arena && e.generation == e.arena->generation.load(std::memory_order_acquire)) e.flush();
+        }
+    }
+
+    ~MemoryThreadCache() {
+        for (Entry& e : entries) {
+            if (!e.arena || e.generation != e.arena->generation.load(std::memory_order_acquire)) continue;
+            e.flush();
+            for (int c = 0; c < MEMORY_SLAB_CLASSES; c++) {
+                PluginArena::FreeNode* tail = e.lists[c];
+                if (!tail) continue;
+                while (tail->next) tail = tail->next;
+                e.arena->give_back(c, e.lists[c], tail);
+            }
+        }
+    }
+};
+
+static thread_local MemoryThreadCache THREAD_CACHE;
+
+// ================= Arena =================
+
+void PluginArena::counted(int64_t bytes, uint32_t allocationCount) {
+    int64_t now = live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    int64_t top = peak.load(std::memory_order_relaxed);
+    while (now > top && !peak.compare_exchange_weak(top, now, std::memory_order_relaxed)) {}
+    if (allocationCount) allocations.fetch_add(allocationCount, std::memory_order_relaxed);
+}
+
+void* PluginArena::allocate(uint32_t size) {
+    int c = size_class((uint64_t)size + sizeof(AllocHeader));
+    if (c < 0) return allocate_large(size);
+
+    MemoryThreadCache::Entry& cache = THREAD_CACHE.get(this);
+    if (!cache.lists[c]) {
+        cache.lists[c] = refill(c, MEMORY_CACHE_BATCH);
+        cache.counts[c] = MEMORY_CACHE_BATCH;
+    }
+
+    FreeNode* node = cache.lists[c];
+    cache.lists[c] = node->next;
+    cache.counts[c]--;
+
+    AllocHeader* header = reinterpret_cast<AllocHeader*>(node);
+    header->arena = this;
+    header->sizeClass = (uint32_t)c;
+    header->generation = cache.generation;
+    cache.note(class_size(c), 1);
+    return header + 1;
+}
+
+void* PluginArena::allocate_large(uint32_t size) {
+    uint64_t total = sizeof(LargeBlock) + sizeof(AllocHeader) + (uint64_t)size;
+    char* raw = new char[total];
+    LargeBlock* node = reinterpret_cast<LargeBlock*>(raw);
+    node->size = total;
+
+    AllocHeader* header = reinterpret_cast<AllocHeader*>(raw + sizeof(LargeBlock));
+    header->arena = this;
+    header->sizeClass = MEMORY_LARGE;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        header->generation = generation.load(std::memory_order_relaxed);
+        node->prev = nullptr;
+        node->next = large;
+        if (large) large->prev = node;
+        large = node;
+    }
+    reserved.fetch_add(total, std::memory_order_relaxed);
+    counted((int64_t)total, 1);
+    return header + 1;
+}
+
+// Takes count nodes from the free list, carving new slabs when it runs dry
+PluginArena::FreeNode* PluginArena::refill(int sizeClass, uint32_t count) {
+    std::lock_guard<std::mutex> guard(lock);
+    uint32_t slab = class_size(sizeClass);
+    FreeNode* head = nullptr;
+
+    for (uint32_t i = 0; i < count; i++) {
+        FreeNode* node = freeLists[sizeClass];
+        if (node) {
+            freeLists[sizeClass] = node->next;
+        } else {
+            if (!cursor || cursor + slab > end) {
+                char* block = new char[MEMORY_BLOCK_SIZE];
+                blocks.push_back(block);
+                reserved.fetch_add(MEMORY_BLOCK_SIZE, std::memory_order_relaxed);
+                cursor = block;
+                end = block + MEMORY_BLOCK_SIZE;
+            }
+            node = reinterpret_cast<FreeNode*>(cursor);
+            cursor += slab;
+        }
+        node->next = head;
+        head = node;
+    }
+    return head;
+}
+
+void PluginArena::give_back(int sizeClass, FreeNode* head, FreeNode* tail) {
+    std::lock_guard<std::mutex> guard(lock);
+    tail->next = freeLists[sizeClass];
+    freeLists[sizeClass] = head;
+}
+
+void PluginArena::free(void* ptr) {
+    if (!ptr) return;
+    AllocHeader* header = reinterpret_cast<AllocHeader*>(ptr) - 1;
+    PluginArena* arena = header->arena;
+
+    if (header->sizeClass == MEMORY_LARGE) {
+        LargeBlock* node = reinterpret_cast<LargeBlock*>(reinterpret_cast<char*>(header) - sizeof(LargeBlock));
+        uint64_t size = node->size;
+        {
+            std::lock_guard<std::mutex> guard(arena->lock);
+            if (node->prev) node->prev->next = node->next;
+            else arena->large = node->next;
+            if (node->next) node->next->prev = node->prev;
+        }
+        delete[] reinterpret_cast<char*>(node);
+        arena->reserved.fetch_sub(size, std::memory_order_relaxed);
+        arena->counted(-(int64_t)size, 0);
+        return;
+    }
+
+    int c = (int)header->sizeClass;
+    MemoryThreadCache::Entry& cache = THREAD_CACHE.get(arena);
+    if (header->generation != cache.generation) return; // From before a release, already gone
+
+    FreeNode* node = reinterpret_cast<FreeNode*>(header);
+    node->next = cache.lists[c];
+    cache.lists[c] = node;
+    cache.note(-(int64_t)class_size(c), 0);
+
+    // Hand a batch back so memory freed on one thread can be reused on another
+    if (++cache.counts[c] > MEMORY_CACHE_MAX) {
+        FreeNode* head = cache.lists[c];
+        FreeNode* tail = head;
+        for (int i = 1; i < MEMORY_CACHE_BATCH; i++) tail = tail->next;
+        cache.lists[c] = tail->next;
+        cache.counts[c] -= MEMORY_CACHE_BATCH;
+        arena->give_back(c, head, tail);
+    }
+}
+
+void* PluginArena::allocate_frame(uint32_t size) {
+    if (size > MEMORY_FRAME_MAX) return nullptr;
+    uint64_t aligned = ((uint64_t)size + MEMORY_ALIGN - 1) & ~(uint64_t)(MEMORY_ALIGN - 1);
+    if (aligned == 0) aligned = MEMORY_ALIGN;
+
+    for (;;) {
+        // Chunk index in the high half, offset in the low half, bumped as one
+        uint64_t state = frameState.fetch_add(aligned, std::memory_order_acq_rel);
+        uint32_t chunk = (uint32_t)(state >> 32);
+        uint64_t offset = state & 0xFFFFFFFFu;
+        if (chunk < frameChunkCount.load(std::memory_order_acquire) && offset + aligned <= frameChunks[chunk].size) {
+            return frameChunks[chunk].data + offset;
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        if ((uint32_t)(frameState.load(std::memory_order_acquire) >> 32) != chunk) continue; // Someone moved on
+        if (chunk < frameChunkCount && offset + aligned <= frameChunks[chunk].size) continue;
+
+        uint32_t next = chunk < frameChunkCount ? chunk + 1 : chunk;
+        if (chunk < frameChunkCount) frameUsed += frameChunks[chunk].size;
+        if (next >= MEMORY_FRAME_CHUNKS) return nullptr;
+
+        // Later chunks double, an oversized request gets a chunk of its own size
+        if (next >= frameChunkCount || frameChunks[next].size < aligned) {
+            if (next < frameChunkCount) {
+                reserved.fetch_sub(frameChunks[next].size, std::memory_order_relaxed);
+                delete[] frameChunks[next].data;
+            }
+            uint32_t chunkSize = std::max<uint32_t>((uint32_t)aligned, (uint32_t)MEMORY_BLOCK_SIZE << std::min<uint32_t>(next, 10));
+            frameChunks[next] = {new char[chunkSize], chunkSize};
+            reserved.fetch_add(chunkSize, std::memory_order_relaxed);
+            if (next >= frameChunkCount) frameChunkCount.store(next + 1, std::memory_order_release);
+        }
+        frameState.store((uint64_t)next << 32, std::memory_order_release);
+    }
+}
+
+void PluginArena::next_frame() {
+    uint64_t state = frameState.load(std::memory_order_acquire);
+    if (state == 0 && frameUsed == 0) return;
+
+    uint32_t chunk = (uint32_t)(state >> 32);
+    uint64_t offset = state & 0xFFFFFFFFu;
+    uint64_t used = frameUsed;
+    if (chunk < frameChunkCount) used += std::min<uint64_t>(offset, frameChunks[chunk].size);
+
+    if (used > framePeak.load(std::memory_order_relaxed)) framePeak.store(used, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> guard(lock);
+    frameUsed = 0;
+    frameState.store(0, std::memory_order_release);
+}
+
+void PluginArena::release() {
+    std::lock_guard<std::mutex> guard(lock);
+    for (char* block : blocks) delete[] block;
+    blocks.clear();
+    cursor = end = nullptr;
+    for (auto& list : freeLists) list = nullptr;
+
+    while (large) {
+        LargeBlock* next = large->next;
+        delete[] reinterpret_cast<char*>(large);
+        large = next;
+    }
+
+    for (uint32_t i = 0; i < frameChunkCount; i++) delete[] frameChunks[i].data;
+    frameChunkCount.store(0, std::memory_order_release);
+    frameState.store(0, std::memory_order_release);
+    frameUsed = 0;
+
+    live = 0;
+    reserved = 0;
+    generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
+// ================= Memory =================
+
+PluginArena* Memory::arena(const std::string& name) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = arenas.find(name);
+    if (it != arenas.end()) return it->second.get();
+
+    auto a = std::make_unique<PluginArena>();
+    a->name = name;
+    a->id = (uint32_t)ordered.size();
+    ordered.push_back(a.get());
+    return arenas.emplace(name, std::move(a)).first->second.get();
+}
+
+void Memory::next_frame() {
+    // The main thread's counts are exact at every frame boundary
+    THREAD_CACHE.flush();
+
+    std::lock_guard<std::mutex> guard(lock);
+    for (PluginArena* a : ordered) a->next_frame();
+}
+
+void Memory::release(PluginArena* arena) {
+    if (arena) arena->release();
+}
+
+std::string Memory::usage() const {
+    std::lock_guard<std::mutex> guard(lock);
+    std::vector<const PluginArena*> sorted(ordered.begin(), ordered.end());
+    std::sort(sorted.begin(), sorted.end(),
+        [](const PluginArena* a, const PluginArena* b) { return a->name < b->name; });
+
+    std::string out;
+    for (const PluginArena* a : sorted) {
+        if (a->allocations == 0 && a->reserved == 0 && a->framePeak == 0) continue;
+        out += (a->name.empty() ? std::string("host") : a->name) +
+               " live " + std::to_string(a->live.load()) +
+               " peak " + std::to_string(a->peak.load()) +
+               " allocs " + std::to_string(a->allocations.load()) +
+               " reserved " + std::to_string(a->reserved.load()) +
+               " frame " + std::to_string(a->framePeak.load()) + "\n";
+    }
+    return out;
+}
+
+void Memory::metrics(std::vector<MetricSample>& out) const {
+    std::lock_guard<std::mutex> guard(lock);
+    std::vector<const PluginArena*> sorted(ordered.begin(), ordered.end());
+    std::sort(sorted.begin(), sorted.end(),
+        [](const PluginArena* a, const PluginArena* b) { return a->name < b->name; });
+
+    for (const PluginArena* a : sorted) {
+        std::string name = a->name.empty() ? "host" : a->name;
+        out.push_back({metric_key("runtime_memory_live_bytes", "plugin", name), METRIC_GAUGE, (double)a->live.load()});
+        out.push_back({metric_key("runtime_memory_peak_bytes", "plugin", name), METRIC_GAUGE, (double)a->peak.load()});
+        out.push_back({metric_key("runtime_memory_reserved_bytes", "plugin", name), METRIC_GAUGE, (double)a->reserved.load()});
+        out.push_back({metric_key("runtime_memory_allocations_total", "plugin", name), METRIC_COUNTER, (double)a->allocations.load()});
+    }
+}
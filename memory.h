@@ -0,0 +1,100 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "metrics.h"
+
+// Per-plugin memory arenas
+//
+// Backs the host's alloc_memory / free_memory / alloc_frame calls. Every
+// plugin gets an arena that hands out small blocks from size-class slabs
+// carved out of 64 KB blocks and gives larger ones their own allocation on
+// the arena's list. Each thread keeps a short free list per arena and class,
+// so a hot alloc/free pair never takes the arena lock. The frame scratch is a
+// bump allocator that is rewound between frames.
+//
+// Every allocation starts with a header naming its arena, so free_memory
+// needs no size. Unloading a plugin releases its arena in one go; a
+// generation bump makes the thread caches drop what they still hold.
+
+#define MEMORY_BLOCK_SIZE (64 * 1024)
+#define MEMORY_SLAB_MIN 32
+#define MEMORY_SLAB_CLASSES 8 // 32 ... 4096 bytes, header included
+#define MEMORY_ALIGN 16
+#define MEMORY_FRAME_CHUNKS 16 // Frame scratch grows by chunks, kept for the next frame
+
+class PluginArena {
+public:
+    std::string name;
+    uint32_t id = 0;
+    std::atomic<uint32_t> generation{1};
+
+    // Threads publish their counts in batches, so live lags by at most a few
+    // hundred operations per thread; the main thread's are exact between frames
+    std::atomic<int64_t> live{0};         // Bytes handed out and not freed, headers included
+    std::atomic<int64_t> peak{0};
+    std::atomic<uint64_t> allocations{0}; // Total alloc_memory calls
+    std::atomic<uint64_t> reserved{0};    // Slab blocks, large allocations and frame chunks
+    std::atomic<uint64_t> framePeak{0};   // Most frame scratch used in one frame
+
+    ~PluginArena() { release(); }
+
+    void* allocate(uint32_t size);
+    void* allocate_frame(uint32_t size);
+    static void free(void* ptr);
+
+    // Rewinds the frame scratch, called between frames
+    void next_frame();
+
+    // Frees everything at once, pointers handed out before are invalid after
+    void release();
+
+private:
+    friend struct MemoryThreadCache;
+    struct FreeNode { FreeNode* next; };
+    struct alignas(MEMORY_ALIGN) LargeBlock { LargeBlock* prev; LargeBlock* next; uint64_t size; };
+    struct FrameChunk { char* data; uint32_t size; };
+
+    void* allocate_large(uint32_t size);
+    FreeNode* refill(int sizeClass, uint32_t count);
+    void give_back(int sizeClass, FreeNode* head, FreeNode* tail);
+    void counted(int64_t bytes, uint32_t allocationCount);
+
+    std::mutex lock;
+    std::vector<char*> blocks;
+    char* cursor = nullptr;
+    char* end = nullptr;
+    FreeNode* freeLists[MEMORY_SLAB_CLASSES] = {};
+    LargeBlock* large = nullptr;
+
+    FrameChunk frameChunks[MEMORY_FRAME_CHUNKS] = {};
+    std::atomic<uint32_t> frameChunkCount{0};
+    std::atomic<uint64_t> frameState{0}; // Chunk being bumped << 32 | offset in it
+    uint64_t frameUsed = 0;              // Bytes in chunks already filled this frame
+};
+
+class Memory {
+public:
+    // Owned by the memory manager, valid for the whole run
+    PluginArena* arena(const std::string& name);
+
+    void next_frame();
+    void release(PluginArena* arena);
+
+    // One line per arena: live, peak, allocations, reserved, frame peak
+    std::string usage() const;
+
+    // Live, peak and reserved bytes per arena, for the metrics page
+    void metrics(std::vector<MetricSample>& out) const;
+
+private:
+    mutable std::mutex lock;
+    std::unordered_map<std::string, std::unique_ptr<PluginArena>> arenas;
+    std::vector<PluginArena*> ordered; // By id, for next_frame
+};
+
+extern Memory MEMORY;
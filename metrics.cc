@@ -0,0 +1,263 @@
+#include "metrics.h"
+#include "log.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+    #define _WINSOCKAPI_
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+MetricsPage METRICS;
+PluginMetrics PLUGIN_METRICS;
+
+void MetricsPage::configure(const std::vector<std::string>& entries) {
+    for (const auto& entry : entries) {
+        size_t eq_pos = entry.find('=');
+        if (eq_pos == std::string::npos) continue;
+
+        std::string key = entry.substr(0, eq_pos);
+        std::string value = entry.substr(eq_pos + 1);
+
+        try {
+            if (key == "file") path = value;
+            else if (key == "capacity") capacity = (uint32_t)std::stoul(value);
+            else if (key == "interval_ms") intervalNs = (uint64_t)(std::stod(value) * 1e6);
+            else log_warn("[Metrics] Unknown entry: " + entry);
+        } catch (...) {
+            log_warn("[Metrics] Ignoring invalid entry: " + entry);
+        }
+    }
+    if (capacity == 0) capacity = 1;
+}
+
+static void escape_label(char c, std::string& out) {
+    if (c == '\\' || c == '"') out += '\\';
+    if (c == '\n') out += "\\n";
+    else out += c;
+}
+
+std::string metric_key(const char* name, const char* label, const std::string& value) {
+    std::string key = std::string(name) + "{" + label + "=\"";
+    size_t start = key.size();
+    for (char c : value) escape_label(c, key);
+    if (key.size() + 2 < METRICS_KEY_MAX) return key + "\"}";
+
+    // Too long for a page entry: a prefix of the value and a hash of all of it,
+    // so the series stays well formed and two long values stay apart
+    const size_t hashLength = 9; // ~ and 8 hex digits
+    if (start + hashLength + 2 >= METRICS_KEY_MAX) return key + "\"}"; // Name alone too long, publish leaves it out
+
+    uint32_t hash = 2166136261u;
+    for (char c : value) hash = (hash ^ (uint8_t)c) * 16777619u;
+
+    size_t room = METRICS_KEY_MAX - 1 - start - hashLength - 2;
+    key.resize(start);
+    size_t used = 0;
+    for (char c : value) {
+        std::string piece;
+        escape_label(c, piece);
+        if (key.size() - start + piece.size() > room) break;
+        key += piece;
+        used++;
+    }
+    // Never end inside a UTF-8 sequence, multi-byte characters are never escaped
+    while (used > 0 && used < value.size() && ((uint8_t)value[used] & 0xC0) == 0x80) {
+        key.pop_back();
+        used--;
+    }
+
+    static std::atomic<bool> warned{false};
+    if (!warned.exchange(true)) {
+        log_warn("[Metrics] Label values too long for a " + std::to_string(METRICS_KEY_MAX) +
+                 " byte key are shortened and hashed, first: " + value);
+    }
+
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), "~%08x", hash);
+    return key + suffix + "\"}";
+}
+
+// ================= Mapping =================
+
+bool MetricsPage::open() {
+    if (path.empty() || header) return header != nullptr;
+    mappedSize = sizeof(MetricsHeader) + (size_t)capacity * sizeof(MetricsEntry);
+
+#ifdef _WIN32
+    HANDLE f = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                           nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (f == INVALID_HANDLE_VALUE) {
+        log_error("[Metrics] Cannot create " + path);
+        return false;
+    }
+    HANDLE m = CreateFileMappingA(f, nullptr, PAGE_READWRITE, (DWORD)((uint64_t)mappedSize >> 32), (DWORD)mappedSize, nullptr);
+    void* view = m ? MapViewOfFile(m, FILE_MAP_WRITE, 0, 0, mappedSize) : nullptr;
+    if (!view) {
+        if (m) CloseHandle(m);
+        CloseHandle(f);
+        log_error("[Metrics] Cannot map " + path);
+        return false;
+    }
+    file = f;
+    mapping = m;
+#else
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        log_error("[Metrics] Cannot create " + path);
+        return false;
+    }
+    void* view = ftruncate(fd, (off_t)mappedSize) == 0
+        ? mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (view == MAP_FAILED) {
+        ::close(fd);
+        fd = -1;
+        log_error("[Metrics] Cannot map " + path);
+        return false;
+    }
+#endif
+
+    // A fresh file is all zeroes; magic goes in last so readers never see a half-made header
+    header = static_cast<MetricsHeader*>(view);
+    entries = reinterpret_cast<MetricsEntry*>(header + 1);
+    header->version = METRICS_VERSION;
+    header->capacity = capacity;
+    header->count = 0;
+    header->sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = METRICS_MAGIC;
+    keys.clear();
+
+    log_info("[Metrics] Publishing " + std::to_string(capacity) + " entries to " + path);
+    return true;
+}
+
+void MetricsPage::close() {
+    if (!header) return;
+    header->magic = 0;
+#ifdef _WIN32
+    UnmapViewOfFile(header);
+    CloseHandle((HANDLE)mapping);
+    CloseHandle((HANDLE)file);
+    file = mapping = nullptr;
+#else
+    munmap(header, mappedSize);
+    ::close(fd);
+    fd = -1;
+#endif
+    header = nullptr;
+    entries = nullptr;
+    mappedSize = 0;
+}
+
+// ================= Publishing =================
+
+void MetricsPage::publish(const std::vector<MetricSample>& samples, uint64_t nowNs) {
+    if (!header) return;
+    lastPublishNs = nowNs;
+
+    // metric_key shortens label values; a key too long even so is left out, never cut
+    const std::vector<MetricSample>* source = &samples;
+    auto tooLong = [](const MetricSample& sample) { return sample.key.size() >= METRICS_KEY_MAX; };
+    if (std::any_of(samples.begin(), samples.end(), tooLong)) {
+        fitting.clear();
+        for (const MetricSample& sample : samples) {
+            if (!tooLong(sample)) fitting.push_back(sample);
+            else if (!warnedLong) {
+                warnedLong = true;
+                log_warn("[Metrics] Leaving out series with a key over " + std::to_string(METRICS_KEY_MAX - 1) +
+                         " bytes: " + sample.key);
+            }
+        }
+        source = &fitting;
+    }
+    publish_fitting(*source, nowNs);
+}
+
+void MetricsPage::publish_fitting(const std::vector<MetricSample>& samples, uint64_t nowNs) {
+    uint32_t count = (uint32_t)std::min<size_t>(samples.size(), capacity);
+    if (count < samples.size() && !warnedFull) {
+        warnedFull = true;
+        log_warn("[Metrics] " + std::to_string(samples.size()) + " series do not fit in " +
+                 std::to_string(capacity) + " entries, raise [METRICS] capacity");
+    }
+
+    bool relayout = count != keys.size();
+    for (uint32_t i = 0; i < count && !relayout; i++) relayout = samples[i].key != keys[i];
+
+    // Odd sequence: readers retry until it is even again
+    uint64_t seq = header->sequence.load(std::memory_order_relaxed);
+    header->sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if (relayout) {
+        keys.resize(count);
+        for (uint32_t i = 0; i < count; i++) {
+            MetricsEntry& e = entries[i];
+            keys[i] = samples[i].key;
+            size_t length = std::min<size_t>(keys[i].size(), METRICS_KEY_MAX - 1);
+            memcpy(e.key, keys[i].data(), length);
+            memset(e.key + length, 0, METRICS_KEY_MAX - length);
+            e.type = samples[i].type;
+        }
+        header->count = count;
+        header->layout++;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t bits;
+        memcpy(&bits, &samples[i].value, sizeof(bits));
+        entries[i].value.store(bits, std::memory_order_relaxed);
+    }
+    header->publishedNs = nowNs;
+
+    header->sequence.store(seq + 2, std::memory_order_release);
+}
+
+// ================= Plugin metrics =================
+
+static bool valid_metric_name(const char* name) {
+    if (!name || !*name) return false;
+    for (const char* c = name; *c; c++) {
+        bool letter = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || *c == '_' || *c == ':';
+        if (!letter && !(c != name && *c >= '0' && *c <= '9')) return false;
+    }
+    return true;
+}
+
+bool PluginMetrics::set(const std::string& plugin, const char* name, uint32_t type, double value) {
+    if (!valid_metric_name(name) || (type != METRIC_COUNTER && type != METRIC_GAUGE)) return false;
+    std::string key = metric_key(name, "plugin", plugin.empty() ? "host" : plugin);
+    if (key.size() >= METRICS_KEY_MAX) return false;
+
+    std::lock_guard<std::mutex> guard(lock);
+    auto found = samples.find(key);
+    if (found == samples.end()) {
+        byPlugin[plugin].push_back(key);
+        samples.emplace(key, MetricSample{key, type, value});
+    } else {
+        found->second.type = type;
+        found->second.value = value;
+    }
+    return true;
+}
+
+size_t PluginMetrics::remove(const std::string& plugin) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto owned = byPlugin.find(plugin);
+    if (owned == byPlugin.end()) return 0;
+
+    size_t removed = owned->second.size();
+    for (const std::string& key : owned->second) samples.erase(key);
+    byPlugin.erase(owned);
+    return removed;
+}
+
+void PluginMetrics::collect(std::vector<MetricSample>& out) const {
+    std::lock_guard<std::mutex> guard(lock);
+    for (const auto& pair : samples) out.push_back(pair.second);
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Shared-memory metrics page
+//
+// With a [METRICS] section the host maps a file and publishes counters and
+// gauges into it between frames. The page is a header followed by a fixed
+// table of entries, guarded by a seqlock: the writer makes `sequence` odd,
+// updates the table and makes it even again. A reader copies the page and
+// keeps the copy if `sequence` was the same even number before and after,
+// so any number of external readers poll it without syscalls or locks in
+// the host. tools/metrics_export.cc turns a page into Prometheus text.
+//
+// Entry keys are complete series names such as
+// runtime_events_dispatched_total{event="tick"}; names are only rewritten
+// when the set of series changes, otherwise a publish only stores values.
+
+#define METRICS_MAGIC 0x54454D50u // "PMET"
+#define METRICS_VERSION 1
+#define METRICS_KEY_MAX 112
+
+// Same values as in plugin_api.h, for the set_metric host call
+#ifndef METRIC_COUNTER
+#define METRIC_COUNTER 0
+#define METRIC_GAUGE 1
+#endif
+
+struct MetricsHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;   // Entries the page has room for
+    uint32_t count;      // Entries in use
+    std::atomic<uint64_t> sequence; // Odd while the host writes
+    uint64_t publishedNs; // Steady clock time of the last publish
+    uint64_t layout;      // Bumped whenever keys change
+    uint64_t reserved[3];
+};
+
+struct MetricsEntry {
+    char key[METRICS_KEY_MAX]; // NUL terminated series name with labels
+    uint32_t type;             // METRIC_COUNTER or METRIC_GAUGE
+    uint32_t pad;
+    std::atomic<uint64_t> value; // Bits of a double
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "metrics page needs lock-free 64-bit atomics");
+static_assert(sizeof(MetricsEntry) == 128, "metrics entry layout changed");
+
+struct MetricSample {
+    std::string key;
+    uint32_t type;
+    double value;
+};
+
+// name{label="value"} with the value escaped for the Prometheus text format.
+// Values that would not fit in an entry keep a prefix and get a hash appended
+std::string metric_key(const char* name, const char* label, const std::string& value);
+
+class MetricsPage {
+public:
+    ~MetricsPage() { close(); }
+
+    // [METRICS] entries: file=<path>, capacity=<entries>, interval_ms=<ms>
+    void configure(const std::vector<std::string>& entries);
+
+    bool open();
+    void close();
+    bool enabled() const { return header != nullptr; }
+
+    // True once interval_ms has passed since the last publish
+    bool due(uint64_t nowNs) const { return header && nowNs - lastPublishNs >= intervalNs; }
+
+    // Samples beyond the capacity or with keys over METRICS_KEY_MAX - 1 bytes
+    // are left out, with one warning each
+    void publish(const std::vector<MetricSample>& samples, uint64_t nowNs);
+
+    std::string path;
+    uint32_t capacity = 1024;
+    uint64_t intervalNs = 0; // Every frame
+
+private:
+    MetricsHeader* header = nullptr;
+    MetricsEntry* entries = nullptr;
+    size_t mappedSize = 0;
+    uint64_t lastPublishNs = 0;
+    bool warnedFull = false;
+    bool warnedLong = false;
+    std::vector<std::string> keys; // As last written
+    std::vector<MetricSample> fitting; // Samples short enough, when some are not
+
+    void publish_fitting(const std::vector<MetricSample>& samples, uint64_t nowNs);
+
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+extern MetricsPage METRICS;
+
+// Counters and gauges plugins report through the set_metric host call,
+// published as <name>{plugin="<file>"}. Any thread
+class PluginMetrics {
+public:
+    // False for names that are not [a-zA-Z_:][a-zA-Z0-9_:]* or too long for the page
+    bool set(const std::string& plugin, const char* name, uint32_t type, double value);
+
+    // Called at unload, the plugin's series leave the page
+    size_t remove(const std::string& plugin);
+
+    void collect(std::vector<MetricSample>& out) const;
+
+private:
+    mutable std::mutex lock;
+    std::map<std::string, MetricSample> samples; // By series, sorted for a stable page layout
+    std::unordered_map<std::string, std::vector<std::string>> byPlugin;
+};
+
+extern PluginMetrics PLUGIN_METRICS;
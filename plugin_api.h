@@ -1,7 +1,22 @@
 #pragma once
 #include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+    #include <array>
+    #include <chrono>
+    #include <cstdlib>
+    #include <cstring>
+    #include <new>
+    #include <string_view>
+    #include <type_traits>
+    #include <utility>
+    #include <vector>
+#endif
 
 #define ABI_V1 1
+#define ABI_V2 2
+#define ABI_CURRENT ABI_V2
 
 #define PRIORITY_DEFAULT 1
 #define PRIORITY_FIRST 0
@@ -10,6 +25,42 @@
 #define DEP_TYPE_REQUIRED 0
 #define DEP_TYPE_OPTIONAL 1
 
+// DataValue types
+#define DATA_NONE 0
+#define DATA_STRING 1
+#define DATA_INT64 2
+#define DATA_DOUBLE 3
+#define DATA_BYTES 4
+
+// PluginDescriptor kinds (ABI v2)
+#define DESC_DEPENDENCY 0
+#define DESC_CAPABILITY 1
+
+// PluginInfoV2::features, what the plugin declares about itself
+#define PLUGIN_FEATURE_THREAD_SAFE (1ull << 0) // Handlers may be called from any thread
+
+// PluginHost::features, what the host offers beyond the v1 table
+#define HOST_FEATURE_BATCH (1ull << 0) // send_events, get_data_many, set_data_many, register_events
+#define HOST_FEATURE_TYPED_EVENTS (1ull << 1) // register_typed, unregister_typed, send_typed
+#define HOST_FEATURE_WATCH (1ull << 2) // watch_data, unwatch_data
+#define HOST_FEATURE_TYPED_DATA (1ull << 3) // set_value, get_value, add_value, compare_and_swap, exchange_value, expire_data
+#define HOST_FEATURE_MEMORY (1ull << 4) // alloc_memory, free_memory, alloc_frame
+#define HOST_FEATURE_CLOCK (1ull << 5) // clock_ms
+#define HOST_FEATURE_EVENT_POLICY (1ull << 6) // set_event_policy
+#define HOST_FEATURE_METRICS (1ull << 7) // set_metric
+#define HOST_FEATURE_USERDATA (1ull << 8) // subscribe, unsubscribe, schedule
+
+// set_event_policy: how events of a name reach their listeners
+#define EVENT_POLICY_IMMEDIATE 0 // Dispatched inside send, the default
+#define EVENT_POLICY_LATEST 1    // Held until the end of the frame, only the last one is delivered
+#define EVENT_POLICY_KEYED 2     // Like LATEST per key: text before the first space, or a struct's first 8 bytes
+#define EVENT_POLICY_DEBOUNCE 3  // The last one, once none was sent for windowMs
+#define EVENT_POLICY_THROTTLE 4  // At most one per windowMs, the last one sent in the window
+
+// set_metric types
+#define METRIC_COUNTER 0
+#define METRIC_GAUGE 1
+
 #ifdef _WIN32
     #define pluginbhvr __cdecl
 #else
@@ -28,7 +79,40 @@
     #define PLATFORM_EXPORT __attribute__((visibility("default")))
 #endif
 
-#define expose EXTERN_C PLATFORM_EXPORT
+// Keeps the header's inline state (manifest, typed handlers) private to each
+// plugin library instead of being merged across plugins by the loader
+#if defined(_WIN32)
+    #define PLUGIN_LOCAL
+#else
+    #define PLUGIN_LOCAL __attribute__((visibility("hidden")))
+#endif
+
+#define PLUGIN_PASTE_(a, b) a##b
+#define PLUGIN_PASTE(a, b) PLUGIN_PASTE_(a, b)
+#define PLUGIN_STRING_(a) #a
+#define PLUGIN_STRING(a) PLUGIN_STRING_(a)
+
+// Static bundles: a plugin compiled with -DPLUGIN_STATIC=<file stem> is linked
+// into the runtime instead of being built as a library. Its helpers move into
+// an inline namespace of their own and its entry points get the stem as a
+// prefix, so several plugins fit in one binary, and manifest() adds it to the
+// runtime's static plugin table. plugins.ini still names it as <stem>.so/.dll.
+#ifdef PLUGIN_STATIC
+    #define PLUGIN_NAMESPACE_BEGIN namespace plugin { inline namespace PLUGIN_PASTE(bundle_, PLUGIN_STATIC) {
+    #define PLUGIN_NAMESPACE_END } }
+
+    #define plugin_get_info PLUGIN_PASTE(PLUGIN_STATIC, _plugin_get_info)
+    #define plugin_init PLUGIN_PASTE(PLUGIN_STATIC, _plugin_init)
+    #define plugin_shutdown PLUGIN_PASTE(PLUGIN_STATIC, _plugin_shutdown)
+
+    #define expose EXTERN_C
+#else
+    #define PLUGIN_NAMESPACE_BEGIN namespace plugin PLUGIN_LOCAL {
+    #define PLUGIN_NAMESPACE_END }
+
+    #define expose EXTERN_C PLATFORM_EXPORT
+#endif
+
 #define api expose pluginbhvr
 // expose and pluginbhvr are "legacy" but I will leave them since they are more verbose
 
@@ -39,6 +123,7 @@ struct Dependency {
     uint8_t type; // DEP_TYPE_REQUIRED or DEP_TYPE_OPTIONAL
 };
 
+// ABI v1 layout, still accepted by the host
 struct PluginInfo {
     const char* name;
     const char* version;
@@ -47,12 +132,62 @@ struct PluginInfo {
     Dependency dependencies[128] = {};
 };
 
+// ABI v2: dependencies and capabilities as one variable length list
+struct PluginDescriptor {
+    const char* name;
+    uint8_t kind; // DESC_DEPENDENCY or DESC_CAPABILITY
+    uint8_t type; // DEP_TYPE_* for dependencies
+};
+
+// Shares its first fields with PluginInfo, the host reads abi_version first
+struct PluginInfoV2 {
+    const char* name;
+    const char* version;
+    uint32_t abi_version;
+    char priority;
+    uint32_t descriptor_count;
+    const PluginDescriptor* descriptors;
+    uint64_t features;        // PLUGIN_FEATURE_* bits
+    uint32_t host_table_size; // sizeof(PluginHost) the plugin was built against
+};
+
 // Event callback type
 typedef void (*event_callback_t)(const char* eventName, const char* payload);
 
+// Event handler with the userdata it was registered with, for closures and bindings
+typedef void (*event_handler_t)(void* userdata, const char* eventName, const char* payload);
+
+// Typed event callback, data points at size bytes of a trivially copyable struct
+typedef void (*typed_callback_t)(const char* eventName, const void* data, uint32_t size);
+
 // Logging callback
 typedef void (*log_callback_t)(const char* level, const char* message);
 
+// Batched call elements, passed as contiguous arrays
+struct HostEvent {
+    const char* name;
+    const char* payload;
+};
+
+struct HostKeyValue {
+    const char* key;
+    const char* value; // Filled in by get_data_many, nullptr when missing
+};
+
+struct HostHandler {
+    const char* eventName;
+    event_callback_t callback;
+};
+
+// Typed storage value, only the field matching type is used
+struct DataValue {
+    uint32_t type;    // DATA_*
+    uint32_t size;    // Length of data for strings and bytes
+    int64_t i;
+    double d;
+    const void* data; // Returned values point into host storage, valid until the key is written again
+};
+
 // Host interface passed to plugins
 struct PluginHost {
     // Event system
@@ -76,24 +211,116 @@ struct PluginHost {
     // Timer system
     uint64_t (*set_timer)(uint32_t ms, event_callback_t callback, bool repeat);
     bool (*cancel_timer)(uint64_t timer_id);
+
+    // ABI v2, everything below is only there when table_size covers it
+    uint32_t abi_version;
+    uint32_t table_size; // sizeof(PluginHost) on the host side
+    uint64_t features;   // HOST_FEATURE_* bits
+
+    // HOST_FEATURE_BATCH: one call for many items
+    void (*send_events)(const HostEvent* events, uint32_t count);
+    uint32_t (*set_data_many)(const HostKeyValue* items, uint32_t count);   // Returns how many were stored
+    uint32_t (*get_data_many)(HostKeyValue* items, uint32_t count);         // Returns how many were found
+    void (*register_events)(const HostHandler* handlers, uint32_t count);
+
+    // HOST_FEATURE_TYPED_EVENTS: raw struct payloads checked against a layout hash
+    bool (*register_typed)(const char* eventName, uint64_t layoutHash, uint32_t size, typed_callback_t callback); // False on a layout mismatch
+    void (*unregister_typed)(typed_callback_t callback);
+    void (*send_typed)(const char* eventName, uint64_t layoutHash, const void* data, uint32_t size);
+
+    // HOST_FEATURE_WATCH: callback(key, value) once per frame for each changed key,
+    // value is nullptr after a delete. "prefix*" watches every key starting with prefix
+    uint64_t (*watch_data)(const char* keyOrPrefix, event_callback_t callback); // Returns 0 on failure
+    bool (*unwatch_data)(uint64_t watchId);
+
+    // HOST_FEATURE_TYPED_DATA: typed slots and atomic updates, get_data formats numbers as text
+    bool (*set_value)(const char* key, const DataValue* value);
+    bool (*get_value)(const char* key, DataValue* out); // out->type is DATA_NONE when missing
+    bool (*add_value)(const char* key, const DataValue* delta, DataValue* result); // int64 and double only
+    bool (*compare_and_swap)(const char* key, const DataValue* expected, const DataValue* desired);
+    bool (*exchange_value)(const char* key, const DataValue* value, DataValue* previous); // int64 and double only
+    bool (*expire_data)(const char* key, uint32_t ms); // Deletes the key after ms, 0 clears the TTL
+
+    // HOST_FEATURE_MEMORY: from the calling plugin's arena, 16 byte aligned, all of it freed at unload
+    void* (*alloc_memory)(uint32_t size);
+    void (*free_memory)(void* ptr);      // Any thread, nullptr is ignored
+    void* (*alloc_frame)(uint32_t size); // Scratch valid until the end of the current frame, never freed
+
+    // HOST_FEATURE_CLOCK: the host's monotonic clock in ms, the one timers run on. Simulated under --virtual
+    uint64_t (*clock_ms)();
+
+    // HOST_FEATURE_EVENT_POLICY: held events are delivered at the end of the frame, in send order.
+    // Applies to text and typed events of the name, whoever calls it; false for an unknown policy
+    bool (*set_event_policy)(const char* eventName, uint32_t policy, uint32_t windowMs);
+
+    // HOST_FEATURE_METRICS: a counter or gauge on the metrics page, labelled with the calling plugin.
+    // False for names outside [a-zA-Z_:][a-zA-Z0-9_:]*. Removed when the plugin unloads
+    bool (*set_metric)(const char* name, uint32_t type, double value);
+
+    // HOST_FEATURE_USERDATA: handlers called with the userdata they were registered with.
+    // The host never touches userdata; free it after unsubscribe, cancel_timer or a one-shot firing
+    uint64_t (*subscribe)(const char* eventName, event_handler_t handler, void* userdata); // Returns 0 on failure
+    bool (*unsubscribe)(uint64_t handle);
+    uint64_t (*schedule)(uint32_t ms, event_handler_t handler, void* userdata, bool repeat); // Timer id for cancel_timer
 };
 
+// True when the host table passed to plugin_init has the given entry
+#define PLUGIN_HOST_HAS(h, member) \
+    ((h)->abi_version >= ABI_V2 && offsetof(PluginHost, member) + sizeof((h)->member) <= (h)->table_size)
+
 typedef bool (*plugin_init_t)(PluginHost* host);
 typedef void (*plugin_shutdown_t)();
 typedef const PluginInfo* (*plugin_get_info_t)();
 
 }
 
+#ifdef PLUGIN_STATIC
+// The runtime's own table. Statically linked plugins call through it directly,
+// which lets link time optimization see the host function behind each entry
+extern const PluginHost PLUGIN_HOST_TABLE;
+bool plugin_link_static(const char* file, plugin_get_info_t getInfo, plugin_init_t init, plugin_shutdown_t shutdown);
+#endif
+
 // Helper functions
-namespace plugin {
+PLUGIN_NAMESPACE_BEGIN
+#ifdef PLUGIN_STATIC
+    PluginHost* const host = const_cast<PluginHost*>(&PLUGIN_HOST_TABLE);
+    constexpr bool host_ready() { return true; }
+#else
     extern PluginHost* host;
+    // False before sethost() has run
+    inline bool host_ready() { return host != nullptr; }
+#endif
+
+    inline std::vector<PluginDescriptor>& descriptors() {
+        static std::vector<PluginDescriptor> list;
+        return list;
+    }
+
+    inline PluginInfoV2& manifest_info() {
+        static PluginInfoV2 info = {
+            nullptr, nullptr, ABI_V2, PRIORITY_DEFAULT, 0, nullptr, 0, sizeof(PluginHost)
+        };
+        return info;
+    }
+
+    inline void describe(const char* name, uint8_t kind, uint8_t type) {
+        auto& list = descriptors();
+        list.push_back({name, kind, type});
+        manifest_info().descriptors = list.data();
+        manifest_info().descriptor_count = (uint32_t)list.size();
+    }
+
+    inline bool has_feature(uint64_t hostFeature) {
+        return host_ready() && host->abi_version >= ABI_V2 && (host->features & hostFeature) == hostFeature;
+    }
     
     inline void send(const char* event, const char* payload = "") {
-        if (host) host->send_event(event, payload);
+        if (host_ready()) host->send_event(event, payload);
     }
     
     inline void log(const char* level, const char* message) {
-        if (host) host->log(level, message);
+        if (host_ready()) host->log(level, message);
     }
     
     inline void info(const char* message) { log("INFO", message); }
@@ -101,49 +328,371 @@ namespace plugin {
     inline void error(const char* message) { log("ERROR", message); }
     
     inline bool store(const char* key, const char* value) {
-        return host ? host->set_data(key, value) : false;
+        return host_ready() ? host->set_data(key, value) : false;
     }
     
     inline const char* load(const char* key) {
-        return host ? host->get_data(key) : nullptr;
+        return host_ready() ? host->get_data(key) : nullptr;
     }
     
     inline uint64_t timer(uint32_t ms, event_callback_t callback, bool repeat = false) {
-        return host ? host->set_timer(ms, callback, repeat) : 0;
+        return host_ready() ? host->set_timer(ms, callback, repeat) : 0;
     }
     
     inline void on(const char* eventName, event_callback_t callback) {
-        if (host) host->register_event(eventName, callback);
+        if (host_ready()) host->register_event(eventName, callback);
     }
 
     inline void off(event_callback_t callback) {
-        if (host) host->unregister_event(callback);
+        if (host_ready()) host->unregister_event(callback);
     }
-}
 
-#define manifest(name, version) \
+    // Typed storage, numbers stay numbers and updates are atomic on the host
+    inline DataValue int_value(int64_t v) { return {DATA_INT64, 0, v, 0.0, nullptr}; }
+    inline DataValue double_value(double v) { return {DATA_DOUBLE, 0, 0, v, nullptr}; }
+    inline DataValue string_value(const char* s) { return {DATA_STRING, (uint32_t)strlen(s), 0, 0.0, s}; }
+    inline DataValue bytes_value(const void* data, uint32_t size) { return {DATA_BYTES, size, 0, 0.0, data}; }
+    inline DataValue no_value() { return {DATA_NONE, 0, 0, 0.0, nullptr}; }
+
+    inline bool set_value(const char* key, const DataValue& value) {
+        return has_feature(HOST_FEATURE_TYPED_DATA) ? host->set_value(key, &value) : false;
+    }
+
+    inline DataValue get_value(const char* key) {
+        DataValue out = no_value();
+        if (has_feature(HOST_FEATURE_TYPED_DATA)) host->get_value(key, &out);
+        return out;
+    }
+
+    // New value, the key starts at 0 when missing
+    inline int64_t add(const char* key, int64_t delta) {
+        DataValue d = int_value(delta), result = no_value();
+        if (has_feature(HOST_FEATURE_TYPED_DATA)) host->add_value(key, &d, &result);
+        return result.i;
+    }
+
+    inline double add(const char* key, double delta) {
+        DataValue d = double_value(delta), result = no_value();
+        if (has_feature(HOST_FEATURE_TYPED_DATA)) host->add_value(key, &d, &result);
+        return result.d;
+    }
+
+    inline bool compare_and_swap(const char* key, const DataValue& expected, const DataValue& desired) {
+        return has_feature(HOST_FEATURE_TYPED_DATA) ? host->compare_and_swap(key, &expected, &desired) : false;
+    }
+
+    // Previous value, 0 when the key was missing
+    inline int64_t exchange(const char* key, int64_t value) {
+        DataValue v = int_value(value), previous = no_value();
+        if (has_feature(HOST_FEATURE_TYPED_DATA)) host->exchange_value(key, &v, &previous);
+        return previous.i;
+    }
+
+    inline bool expire(const char* key, uint32_t ms) {
+        return has_feature(HOST_FEATURE_TYPED_DATA) ? host->expire_data(key, ms) : false;
+    }
+
+    // Host arena memory, plain malloc/free on hosts without HOST_FEATURE_MEMORY
+    inline void* allocate(uint32_t size) {
+        return has_feature(HOST_FEATURE_MEMORY) ? host->alloc_memory(size) : std::malloc(size);
+    }
+
+    inline void deallocate(void* ptr) {
+        if (has_feature(HOST_FEATURE_MEMORY)) host->free_memory(ptr);
+        else std::free(ptr);
+    }
+
+    // Per-frame scratch, nullptr on hosts without HOST_FEATURE_MEMORY
+    inline void* frame_alloc(uint32_t size) {
+        return has_feature(HOST_FEATURE_MEMORY) ? host->alloc_frame(size) : nullptr;
+    }
+
+    // The clock timers run on, steady_clock on hosts without HOST_FEATURE_CLOCK
+    inline uint64_t now_ms() {
+        if (has_feature(HOST_FEATURE_CLOCK)) return host->clock_ms();
+        return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // For containers, e.g. std::vector<int, plugin::allocator<int>>
+    template <typename T>
+    struct allocator {
+        using value_type = T;
+        allocator() = default;
+        template <typename U> allocator(const allocator<U>&) {}
+
+        T* allocate(size_t n) {
+            void* p = n * sizeof(T) <= UINT32_MAX ? plugin::allocate((uint32_t)(n * sizeof(T))) : nullptr;
+            if (!p) throw std::bad_alloc();
+            return static_cast<T*>(p);
+        }
+        void deallocate(T* p, size_t) { plugin::deallocate(p); }
+
+        template <typename U> bool operator==(const allocator<U>&) const { return true; }
+        template <typename U> bool operator!=(const allocator<U>&) const { return false; }
+    };
+
+    inline uint64_t watch(const char* keyOrPrefix, event_callback_t callback) {
+        return has_feature(HOST_FEATURE_WATCH) ? host->watch_data(keyOrPrefix, callback) : 0;
+    }
+
+    inline bool unwatch(uint64_t watchId) {
+        return has_feature(HOST_FEATURE_WATCH) ? host->unwatch_data(watchId) : false;
+    }
+
+    // Batched variants, fall back to one call per item on hosts without them
+    inline void send_many(const HostEvent* events, uint32_t count) {
+        if (!host_ready()) return;
+        if (has_feature(HOST_FEATURE_BATCH)) { host->send_events(events, count); return; }
+        for (uint32_t i = 0; i < count; i++) host->send_event(events[i].name, events[i].payload);
+    }
+
+    inline uint32_t store_many(const HostKeyValue* items, uint32_t count) {
+        if (!host_ready()) return 0;
+        if (has_feature(HOST_FEATURE_BATCH)) return host->set_data_many(items, count);
+        uint32_t stored = 0;
+        for (uint32_t i = 0; i < count; i++) stored += host->set_data(items[i].key, items[i].value) ? 1 : 0;
+        return stored;
+    }
+
+    inline uint32_t load_many(HostKeyValue* items, uint32_t count) {
+        if (!host_ready()) return 0;
+        if (has_feature(HOST_FEATURE_BATCH)) return host->get_data_many(items, count);
+        uint32_t found = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            items[i].value = host->get_data(items[i].key);
+            if (items[i].value) found++;
+        }
+        return found;
+    }
+
+    inline void on_many(const HostHandler* handlers, uint32_t count) {
+        if (!host_ready()) return;
+        if (has_feature(HOST_FEATURE_BATCH)) { host->register_events(handlers, count); return; }
+        for (uint32_t i = 0; i < count; i++) host->register_event(handlers[i].eventName, handlers[i].callback);
+    }
+
+    // Typed events
+    //
+    // Any trivially copyable struct can be an event. The name is the type's
+    // qualified name unless it declares `static constexpr const char* event_name`,
+    // and the layout hash covers the name, size, alignment and an optional
+    // `static constexpr uint32_t event_version`. Bump event_version when fields
+    // change without changing the size.
+    namespace detail {
+        constexpr uint64_t fnv1a(std::string_view s, uint64_t hash = 1469598103934665603ull) {
+            for (char c : s) {
+                hash ^= (unsigned char)c;
+                hash *= 1099511628211ull;
+            }
+            return hash;
+        }
+
+        constexpr uint64_t mix(uint64_t hash, uint64_t value) {
+            for (int i = 0; i < 8; i++) {
+                hash ^= (value >> (i * 8)) & 0xff;
+                hash *= 1099511628211ull;
+            }
+            return hash;
+        }
+
+        constexpr std::string_view strip_tag(std::string_view name) {
+            for (std::string_view tag : {"struct ", "class ", "enum ", "union "}) {
+                if (name.substr(0, tag.size()) == tag) return name.substr(tag.size());
+            }
+            return name;
+        }
+
+        template <typename T>
+        constexpr std::string_view type_name() {
+        #if defined(_MSC_VER) && !defined(__clang__)
+            std::string_view f = __FUNCSIG__;
+            size_t begin = f.find("type_name<") + 10;
+            size_t end = f.rfind(">(void)");
+        #else
+            std::string_view f = __PRETTY_FUNCTION__;
+            size_t begin = f.find("T = ") + 4;
+            size_t end = f.find_first_of(";]", begin);
+        #endif
+            return strip_tag(f.substr(begin, end - begin));
+        }
+
+        template <typename T, typename = void>
+        struct has_event_name : std::false_type {};
+        template <typename T>
+        struct has_event_name<T, std::void_t<decltype(T::event_name)>> : std::true_type {};
+
+        template <typename T, typename = void>
+        struct has_event_version : std::false_type {};
+        template <typename T>
+        struct has_event_version<T, std::void_t<decltype(T::event_version)>> : std::true_type {};
+
+        template <typename T>
+        constexpr std::string_view event_name_view() {
+            if constexpr (has_event_name<T>::value) return std::string_view(T::event_name);
+            else return type_name<T>();
+        }
+
+        template <typename T, size_t... I>
+        constexpr std::array<char, sizeof...(I) + 1> terminated(std::index_sequence<I...>) {
+            return {{event_name_view<T>()[I]..., '\0'}};
+        }
+
+        template <typename T>
+        std::vector<void (*)(const T&)>& typed_handlers() {
+            static std::vector<void (*)(const T&)> list;
+            return list;
+        }
+
+        // One host registration per type, fans out to every handler added with on<T>()
+        template <typename T>
+        void typed_trampoline(const char*, const void* data, uint32_t size) {
+            if (size != sizeof(T)) return;
+            T value;
+            memcpy(&value, data, sizeof(T));
+            for (auto handler : typed_handlers<T>()) handler(value);
+        }
+    }
+
+    template <typename T>
+    struct event_type {
+        static_assert(std::is_trivially_copyable_v<T>, "typed events must be trivially copyable");
+
+        static constexpr std::string_view view = detail::event_name_view<T>();
+        static constexpr auto storage = detail::terminated<T>(std::make_index_sequence<view.size()>());
+
+        static constexpr const char* name() { return storage.data(); }
+
+        static constexpr uint64_t layout_hash() {
+            uint64_t version = 0;
+            if constexpr (detail::has_event_version<T>::value) version = T::event_version;
+            uint64_t hash = detail::fnv1a(view);
+            hash = detail::mix(hash, sizeof(T));
+            hash = detail::mix(hash, alignof(T));
+            return detail::mix(hash, version);
+        }
+    };
+
+    template <typename T>
+    inline bool emit(const T& value) {
+        if (!has_feature(HOST_FEATURE_TYPED_EVENTS)) return false;
+        host->send_typed(event_type<T>::name(), event_type<T>::layout_hash(), &value, (uint32_t)sizeof(T));
+        return true;
+    }
+
+    // False when the host has no typed events or another plugin registered
+    // this name with a different layout
+    template <typename T>
+    inline bool on(void (*handler)(const T&)) {
+        if (!has_feature(HOST_FEATURE_TYPED_EVENTS)) return false;
+        auto& handlers = detail::typed_handlers<T>();
+        if (handlers.empty() &&
+            !host->register_typed(event_type<T>::name(), event_type<T>::layout_hash(),
+                                  (uint32_t)sizeof(T), detail::typed_trampoline<T>)) {
+            return false;
+        }
+        handlers.push_back(handler);
+        return true;
+    }
+
+    // Delivery policy for an event name, see EVENT_POLICY_*. False on hosts without HOST_FEATURE_EVENT_POLICY
+    inline bool policy(const char* eventName, uint32_t eventPolicy, uint32_t windowMs = 0) {
+        return has_feature(HOST_FEATURE_EVENT_POLICY) ? host->set_event_policy(eventName, eventPolicy, windowMs) : false;
+    }
+
+    template <typename T>
+    inline bool policy(uint32_t eventPolicy, uint32_t windowMs = 0) {
+        return policy(event_type<T>::name(), eventPolicy, windowMs);
+    }
+
+    // Metrics page entries, see [METRICS]. Counters only ever go up
+    inline bool gauge(const char* name, double value) {
+        return has_feature(HOST_FEATURE_METRICS) ? host->set_metric(name, METRIC_GAUGE, value) : false;
+    }
+
+    inline bool counter(const char* name, double total) {
+        return has_feature(HOST_FEATURE_METRICS) ? host->set_metric(name, METRIC_COUNTER, total) : false;
+    }
+
+    // Handlers with userdata, see HOST_FEATURE_USERDATA. 0 when the host lacks it
+    inline uint64_t subscribe(const char* eventName, event_handler_t handler, void* userdata) {
+        return has_feature(HOST_FEATURE_USERDATA) ? host->subscribe(eventName, handler, userdata) : 0;
+    }
+
+    inline bool unsubscribe(uint64_t handle) {
+        return has_feature(HOST_FEATURE_USERDATA) ? host->unsubscribe(handle) : false;
+    }
+
+    inline uint64_t schedule(uint32_t ms, event_handler_t handler, void* userdata, bool repeat = false) {
+        return has_feature(HOST_FEATURE_USERDATA) ? host->schedule(ms, handler, userdata, repeat) : 0;
+    }
+
+    namespace detail {
+        template <typename F>
+        void closure_trampoline(void* userdata, const char* eventName, const char* payload) {
+            (*static_cast<F*>(userdata))(eventName, payload);
+        }
+    }
+
+    // Any callable f(eventName, payload), called in place: no copy, no allocation.
+    // f must outlive the subscription or timer
+    template <typename F>
+    inline uint64_t subscribe(const char* eventName, F& f) {
+        return subscribe(eventName, detail::closure_trampoline<F>, &f);
+    }
+
+    template <typename F>
+    inline uint64_t schedule(uint32_t ms, F& f, bool repeat = false) {
+        return schedule(ms, detail::closure_trampoline<F>, &f, repeat);
+    }
+
+    template <typename T>
+    inline void off() {
+        detail::typed_handlers<T>().clear();
+        if (has_feature(HOST_FEATURE_TYPED_EVENTS)) host->unregister_typed(detail::typed_trampoline<T>);
+    }
+PLUGIN_NAMESPACE_END
+
+#define manifest_info_function(plugin_name, plugin_version) \
     expose pluginbhvr const PluginInfo* plugin_get_info() { \
-        static PluginInfo info = {name, version, ABI_V1, PRIORITY_DEFAULT}; \
-        return &info; \
+        PluginInfoV2& info = plugin::manifest_info(); \
+        info.name = plugin_name; \
+        info.version = plugin_version; \
+        return reinterpret_cast<const PluginInfo*>(&info); \
     }
 
+#ifdef PLUGIN_STATIC
+#define manifest(plugin_name, plugin_version) \
+    manifest_info_function(plugin_name, plugin_version) \
+    expose pluginbhvr bool plugin_init(PluginHost* host); \
+    expose pluginbhvr void plugin_shutdown(); \
+    static const bool PLUGIN_PASTE(plugin_linked_, PLUGIN_STATIC) = \
+        plugin_link_static(PLUGIN_STRING(PLUGIN_STATIC), plugin_get_info, plugin_init, plugin_shutdown);
+
+#define start()
+
+#define sethost() \
+    (void)host;
+#else
+#define manifest(plugin_name, plugin_version) \
+    manifest_info_function(plugin_name, plugin_version)
+
 #define start() \
-    namespace plugin { PluginHost* host = nullptr; } \
+    namespace plugin PLUGIN_LOCAL { PluginHost* host = nullptr; } \
 
 #define sethost() \
     plugin::host = host;        
+#endif
 
 #define dependency(dep_name, dep_type) \
-    {\
-        PluginInfo *info = const_cast<PluginInfo*>(plugin_get_info()); \
-        static Dependency dep = {dep_name, dep_type}; \
-        for (size_t i = 0; i < 128; i++) { \
-            if (info->dependencies[i].name == nullptr || info->dependencies[i].name[0] == '\0') { \
-                info->dependencies[i] = dep; \
-                break; \
-            } \
-        } \
-    }
+    { plugin::describe(dep_name, DESC_DEPENDENCY, dep_type); }
+
+// Something other plugins can depend on instead of a file name
+#define capability(cap_name) \
+    { plugin::describe(cap_name, DESC_CAPABILITY, 0); }
+
+#define plugin_features(bits) \
+    { plugin::manifest_info().features |= (bits); }
 
 #define event_handler(name) \
-    static void name(const char* eventName, const char* payload)
\ No newline at end of file
+    static void name(const char* eventName, const char* payload)
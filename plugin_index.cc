@@ -0,0 +1,303 @@
+#include "plugin_index.h"
+#include "ABI_compat_layer.h"
+#include "log.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+uint64_t hash_file(const std::string& path) {
+    // FNV-1a 64
+    uint64_t hash = 1469598103934665603ull;
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return 0;
+
+    unsigned char buffer[64 * 1024];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            hash ^= buffer[i];
+            hash *= 1099511628211ull;
+        }
+    }
+    fclose(f);
+    return hash;
+}
+
+static bool is_plugin_file(const fs::path& path) {
+    std::string ext = path.extension().string();
+    return ext == ".so" || ext == ".dll";
+}
+
+bool read_plugin_info(const PluginInfo* info, IndexedPlugin& entry) {
+    entry.valid = false;
+    entry.name = info->name ? info->name : "";
+    entry.version = info->version ? info->version : "";
+    entry.abi_version = info->abi_version;
+    entry.priority = info->priority;
+    entry.dependencies.clear();
+    entry.capabilities.clear();
+    entry.features = 0;
+    entry.host_table_size = 0;
+
+    if (info->abi_version == ABI_V1) {
+        for (const auto& dep : info->dependencies) {
+            if (!dep.name || dep.name[0] == '\0') break;
+            entry.dependencies.push_back({dep.name, dep.type});
+        }
+    } else if (info->abi_version == ABI_V2) {
+        const PluginInfoV2* v2 = reinterpret_cast<const PluginInfoV2*>(info);
+        for (uint32_t i = 0; i < v2->descriptor_count; i++) {
+            const PluginDescriptor& d = v2->descriptors[i];
+            if (!d.name) continue;
+            if (d.kind == DESC_DEPENDENCY) entry.dependencies.push_back({d.name, d.type});
+            else if (d.kind == DESC_CAPABILITY) entry.capabilities.push_back(d.name);
+        }
+        entry.features = v2->features;
+        entry.host_table_size = v2->host_table_size;
+    } else {
+        return false;
+    }
+
+    entry.valid = true;
+    return true;
+}
+
+// ================= Serialization =================
+
+static void put_u32(FILE* f, uint32_t v) { fwrite(&v, sizeof(v), 1, f); }
+static void put_u64(FILE* f, uint64_t v) { fwrite(&v, sizeof(v), 1, f); }
+static void put_str(FILE* f, const std::string& s) {
+    put_u32(f, (uint32_t)s.size());
+    fwrite(s.data(), 1, s.size(), f);
+}
+
+static bool get_u32(FILE* f, uint32_t& v) { return fread(&v, sizeof(v), 1, f) == 1; }
+static bool get_u64(FILE* f, uint64_t& v) { return fread(&v, sizeof(v), 1, f) == 1; }
+static bool get_str(FILE* f, std::string& s) {
+    uint32_t len;
+    if (!get_u32(f, len) || len > (1u << 20)) return false;
+    s.resize(len);
+    return fread(&s[0], 1, len, f) == len;
+}
+
+bool PluginIndex::load(const std::string& path) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+
+    char magic[4];
+    uint32_t version = 0, count = 0;
+    bool ok = fread(magic, 1, 4, f) == 4 && memcmp(magic, PLUGIN_INDEX_MAGIC, 4) == 0 &&
+              get_u32(f, version) && version == PLUGIN_INDEX_VERSION && get_u32(f, count);
+
+    std::unordered_map<std::string, IndexedPlugin> loaded;
+    for (uint32_t i = 0; ok && i < count; i++) {
+        IndexedPlugin e;
+        uint64_t mtime;
+        uint32_t flags, depCount;
+        ok = get_str(f, e.file) && get_u64(f, e.size) && get_u64(f, mtime) && get_u64(f, e.hash) &&
+             get_u32(f, flags) && get_str(f, e.name) && get_str(f, e.version) &&
+             get_u32(f, e.abi_version) && get_u32(f, depCount);
+        e.mtime = (int64_t)mtime;
+        e.valid = flags & 1;
+        e.priority = (int8_t)(flags >> 8);
+
+        for (uint32_t d = 0; ok && d < depCount; d++) {
+            IndexedDependency dep;
+            uint32_t type;
+            ok = get_str(f, dep.name) && get_u32(f, type);
+            dep.type = (uint8_t)type;
+            e.dependencies.push_back(std::move(dep));
+        }
+
+        uint32_t capCount = 0;
+        ok = ok && get_u64(f, e.features) && get_u32(f, e.host_table_size) && get_u32(f, capCount);
+        for (uint32_t c = 0; ok && c < capCount; c++) {
+            std::string cap;
+            ok = get_str(f, cap);
+            e.capabilities.push_back(std::move(cap));
+        }
+        if (ok) loaded[e.file] = std::move(e);
+    }
+    fclose(f);
+
+    if (!ok) {
+        log_warn("[Index] Ignoring unreadable plugin index: " + path);
+        return false;
+    }
+    entries = std::move(loaded);
+    dirty = false;
+    return true;
+}
+
+bool PluginIndex::save(const std::string& path) {
+    std::string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+
+    fwrite(PLUGIN_INDEX_MAGIC, 1, 4, f);
+    put_u32(f, PLUGIN_INDEX_VERSION);
+    uint32_t count = 0;
+    for (const auto& pair : entries) count += pair.second.linked ? 0 : 1;
+    put_u32(f, count);
+    for (const auto& pair : entries) {
+        const IndexedPlugin& e = pair.second;
+        if (e.linked) continue;
+        put_str(f, e.file);
+        put_u64(f, e.size);
+        put_u64(f, (uint64_t)e.mtime);
+        put_u64(f, e.hash);
+        put_u32(f, (e.valid ? 1u : 0u) | ((uint32_t)(uint8_t)e.priority << 8));
+        put_str(f, e.name);
+        put_str(f, e.version);
+        put_u32(f, e.abi_version);
+        put_u32(f, (uint32_t)e.dependencies.size());
+        for (const auto& dep : e.dependencies) {
+            put_str(f, dep.name);
+            put_u32(f, dep.type);
+        }
+        put_u64(f, e.features);
+        put_u32(f, e.host_table_size);
+        put_u32(f, (uint32_t)e.capabilities.size());
+        for (const auto& cap : e.capabilities) put_str(f, cap);
+    }
+    bool ok = fclose(f) == 0;
+
+    // Replace in one step so a crash never leaves half an index
+    std::error_code ec;
+    if (ok) fs::rename(tmp, path, ec);
+    if (!ok || ec) {
+        fs::remove(tmp, ec);
+        return false;
+    }
+    dirty = false;
+    return true;
+}
+
+// ================= Refresh =================
+
+bool PluginIndex::probe(const std::string& dir, IndexedPlugin& entry) {
+    std::string fullPath = dir + entry.file;
+    entry.valid = false;
+
+    PluginHandle handle = PLATFORM_LOAD_LIB(fullPath.c_str());
+    if (!handle) return false;
+
+    plugin_get_info_t getInfo = (plugin_get_info_t)PLATFORM_GET_PROC(handle, "plugin_get_info");
+    bool hasInit = PLATFORM_GET_PROC(handle, "plugin_init") && PLATFORM_GET_PROC(handle, "plugin_shutdown");
+
+    if (getInfo && hasInit) {
+        const PluginInfo* info = getInfo();
+        if (info) read_plugin_info(info, entry);
+    }
+
+    PLATFORM_FREE_LIB(handle);
+    return entry.valid;
+}
+
+size_t PluginIndex::refresh(const std::string& dir) {
+    std::error_code ec;
+    if (!fs::is_directory(dir, ec)) return 0;
+
+    size_t probed = 0;
+    std::unordered_map<std::string, bool> seen;
+
+    for (const auto& file : fs::directory_iterator(dir, ec)) {
+        if (!file.is_regular_file(ec) || !is_plugin_file(file.path())) continue;
+
+        std::string name = file.path().filename().string();
+        uint64_t size = (uint64_t)file.file_size(ec);
+        int64_t mtime = (int64_t)file.last_write_time(ec).time_since_epoch().count();
+        seen[name] = true;
+
+        IndexedPlugin& entry = entries[name];
+        if (entry.linked) continue;
+        if (entry.file == name && entry.size == size && entry.mtime == mtime) continue;
+
+        // Touched but identical files keep their metadata
+        uint64_t hash = hash_file(dir + name);
+        bool sameContent = entry.file == name && entry.hash == hash && entry.size == size;
+
+        entry.file = name;
+        entry.size = size;
+        entry.mtime = mtime;
+        entry.hash = hash;
+        dirty = true;
+
+        if (!sameContent) {
+            probe(dir, entry);
+            probed++;
+        }
+    }
+
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (!seen.count(it->first) && !it->second.linked) {
+            it = entries.erase(it);
+            dirty = true;
+        } else {
+            ++it;
+        }
+    }
+    return probed;
+}
+
+void PluginIndex::update(const std::string& dir, const std::string& file, const PluginInfo* info) {
+    IndexedPlugin& entry = entries[file];
+    if (entry.file != file) {
+        std::error_code ec;
+        fs::path path = dir + file;
+        entry.file = file;
+        entry.size = (uint64_t)fs::file_size(path, ec);
+        entry.mtime = (int64_t)fs::last_write_time(path, ec).time_since_epoch().count();
+        entry.hash = hash_file(path.string());
+    }
+
+    IndexedPlugin updated = entry;
+    read_plugin_info(info, updated);
+
+    bool sameDeps = updated.dependencies.size() == entry.dependencies.size() &&
+        std::equal(updated.dependencies.begin(), updated.dependencies.end(), entry.dependencies.begin(),
+            [](const IndexedDependency& a, const IndexedDependency& b) { return a.name == b.name && a.type == b.type; });
+
+    if (!entry.valid || !sameDeps || updated.capabilities != entry.capabilities ||
+        updated.features != entry.features || updated.host_table_size != entry.host_table_size ||
+        updated.name != entry.name || updated.version != entry.version ||
+        updated.abi_version != entry.abi_version || updated.priority != entry.priority) {
+        entry = std::move(updated);
+        dirty = true;
+    }
+}
+
+void PluginIndex::link(const std::string& file, const PluginInfo* info) {
+    IndexedPlugin entry;
+    entry.file = file;
+    entry.linked = true;
+    read_plugin_info(info, entry);
+    entries[file] = std::move(entry);
+}
+
+const IndexedPlugin* PluginIndex::find(const std::string& file) const {
+    auto it = entries.find(file);
+    return it != entries.end() ? &it->second : nullptr;
+}
+
+const IndexedPlugin* PluginIndex::provider(const std::string& capability) const {
+    for (const IndexedPlugin* e : sorted()) {
+        if (!e->valid) continue;
+        for (const auto& cap : e->capabilities) {
+            if (cap == capability) return e;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<const IndexedPlugin*> PluginIndex::sorted() const {
+    std::vector<const IndexedPlugin*> out;
+    out.reserve(entries.size());
+    for (const auto& pair : entries) out.push_back(&pair.second);
+    std::sort(out.begin(), out.end(),
+        [](const IndexedPlugin* a, const IndexedPlugin* b) { return a->file < b->file; });
+    return out;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "plugin_api.h"
+
+// Cached plugin metadata
+//
+// Keeps what plugin_get_info() reported for every library in the plugin
+// directory, keyed by file name and checked against size, mtime and a
+// content hash. Listing, dependency planning and validation read the cache;
+// only new or changed files are opened. Dependencies added with the
+// dependency() macro during plugin_init are captured the first time the
+// plugin is actually loaded.
+
+#define PLUGIN_INDEX_MAGIC "PIDX"
+#define PLUGIN_INDEX_VERSION 2
+
+struct IndexedDependency {
+    std::string name;
+    uint8_t type;
+};
+
+struct IndexedPlugin {
+    std::string file;
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    uint64_t hash = 0;
+
+    bool valid = false; // Has the required exports and a known ABI version
+    std::string name;
+    std::string version;
+    uint32_t abi_version = 0;
+    int8_t priority = PRIORITY_DEFAULT;
+    std::vector<IndexedDependency> dependencies;
+    std::vector<std::string> capabilities;
+    uint64_t features = 0;
+    uint32_t host_table_size = 0; // 0 for ABI v1 plugins
+    bool linked = false;          // Built into the runtime, not on disk and not saved
+};
+
+// Normalizes a v1 or v2 PluginInfo, false for ABI versions the host does not know
+bool read_plugin_info(const PluginInfo* info, IndexedPlugin& out);
+
+class PluginIndex {
+public:
+    bool load(const std::string& path);
+    bool save(const std::string& path);
+
+    // Re-probes new or changed files in dir and drops deleted ones,
+    // returns the number of files that had to be opened
+    size_t refresh(const std::string& dir);
+
+    const IndexedPlugin* find(const std::string& file) const;
+
+    // First valid plugin declaring the capability, by file name order
+    const IndexedPlugin* provider(const std::string& capability) const;
+
+    // Stores the metadata of a plugin that is loaded and initialized
+    void update(const std::string& dir, const std::string& file, const PluginInfo* info);
+
+    // Adds a statically linked plugin; it shadows a library of the same name
+    void link(const std::string& file, const PluginInfo* info);
+
+    std::vector<const IndexedPlugin*> sorted() const;
+
+    bool dirty = false;
+
+private:
+    bool probe(const std::string& dir, IndexedPlugin& entry);
+
+    std::unordered_map<std::string, IndexedPlugin> entries;
+};
+
+uint64_t hash_file(const std::string& path);
@@ -15,6 +15,11 @@ static void handleCommand(const std::string& cmd) {
                   << "  load <plugin.dll>\n"
                   << "  unload <plugin.dll>\n"
                   << "  list\n"
+                  << "  loglevel <plugin|*> <level>\n"
+                  << "  storage\n"
+                  << "  budget\n"
+                  << "  memory\n"
+                  << "  events\n"
                   << "  help\n";
         return;
     }
@@ -47,11 +52,44 @@ static void handleCommand(const std::string& cmd) {
         return;
     }
 
+    if (token == "loglevel") {
+        std::string target, level;
+        iss >> target >> level;
+
+        if (level.empty()) {
+            plugin::warn("Usage: loglevel <plugin|*> <DEBUG|INFO|WARN|ERROR|OFF>");
+            return;
+        }
+
+        plugin::send("setLogLevel", (target + " " + level).c_str());
+        return;
+    }
+
     if (token == "list") {
         plugin::send("requestPluginList", "");
         return;
     }
 
+    if (token == "storage") {
+        plugin::send("requestStorageUsage", "");
+        return;
+    }
+
+    if (token == "budget") {
+        plugin::send("requestBudgetReport", "");
+        return;
+    }
+
+    if (token == "memory") {
+        plugin::send("requestMemoryUsage", "");
+        return;
+    }
+
+    if (token == "events") {
+        plugin::send("requestEventPolicies", "");
+        return;
+    }
+
     plugin::warn(std::string("Unknown command: ").append(token).c_str());
 }
 
@@ -60,14 +98,79 @@ event_handler(onConsoleInput) {
     handleCommand(payload);
 }
 
+event_handler(onPluginList) {
+    if (!payload) return;
+    std::cout << "[console] Plugins:\n";
+
+    std::istringstream lines(payload);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::cout << "  " << line << "\n";
+    }
+}
+
+event_handler(onStorageUsage) {
+    if (!payload) return;
+    std::cout << "[console] Storage:\n";
+
+    std::istringstream lines(payload);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::cout << "  " << line << "\n";
+    }
+}
+
+event_handler(onBudgetReport) {
+    if (!payload) return;
+    std::cout << "[console] Budgets:\n";
+
+    std::istringstream lines(payload);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::cout << "  " << line << "\n";
+    }
+}
+
+event_handler(onMemoryUsage) {
+    if (!payload) return;
+    std::cout << "[console] Memory:\n";
+
+    std::istringstream lines(payload);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::cout << "  " << line << "\n";
+    }
+}
+
+event_handler(onEventPolicies) {
+    if (!payload) return;
+    std::cout << "[console] Event policies:\n";
+
+    std::istringstream lines(payload);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::cout << "  " << line << "\n";
+    }
+}
+
 manifest("console", "1.0.0")
 
 api bool plugin_init(PluginHost* host){
     sethost();
     plugin::on("consoleInput", onConsoleInput);
+    plugin::on("pluginList", onPluginList);
+    plugin::on("storageUsage", onStorageUsage);
+    plugin::on("budgetReport", onBudgetReport);
+    plugin::on("memoryUsage", onMemoryUsage);
+    plugin::on("eventPolicies", onEventPolicies);
     return true;
 }
 
 api void plugin_shutdown() {
     plugin::off(onConsoleInput);
+    plugin::off(onPluginList);
+    plugin::off(onStorageUsage);
+    plugin::off(onBudgetReport);
+    plugin::off(onMemoryUsage);
+    plugin::off(onEventPolicies);
 }
\ No newline at end of file
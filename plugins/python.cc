@@ -6,13 +6,143 @@
 #include <filesystem>
 #include <iostream>
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 static PluginHost* host = nullptr;
-static std::multimap<std::string, PyObject*> python_event_listeners;
+
+// Callables the host reaches through subscribe and schedule. The userdata
+// is a token rather than the object, so an event still queued for a
+// cancelled timer finds nothing instead of a freed callable
+struct PythonTarget {
+    PyObject* callable;
+    uint64_t timerId; // 0 for event handlers
+    bool once;        // One-shot timer, forgotten after it fires
+};
+static std::unordered_map<uint64_t, PythonTarget> python_targets; // By token, touched with the GIL held
+static std::unordered_map<uint64_t, uint64_t> python_timers;     // Timer id -> token
+static uint64_t next_token = 1;
+static std::vector<uint64_t> python_subscriptions;                // Main thread only
 
 manifest("python", "1.0.0")
 start();
 
+// ================= Interpreter thread =================
+//
+// With [PYTHON] thread=true the interpreter runs on a thread of its own.
+// Events the host delivers are copied into a bounded queue and handled
+// there, so a slow handler never holds up a frame and the main loop never
+// waits on the GIL. Host calls made from Python are posted back and run on
+// the main thread at its next tick: writes and sends return as soon as
+// they are queued, calls that return something wait for it.
+
+struct QueuedEvent {
+    uint64_t token;
+    std::string name;
+    std::string payload;
+    bool hasPayload;
+    std::chrono::steady_clock::time_point queued;
+};
+
+struct InterpreterThread {
+    bool enabled = false;
+    size_t capacity = 1024; // Events waiting before the oldest are dropped
+
+    std::thread worker;
+    std::mutex lock;                    // Never held while Python or the host runs
+    std::condition_variable wake;       // Worker: an event arrived or stopping
+    std::condition_variable answered;   // Worker: a waiting host call ran
+    std::deque<QueuedEvent> events;
+    std::deque<std::function<void()>> calls; // Posted by the worker, run on the main thread
+    bool stopping = false;
+
+    // Metrics, published from the main thread
+    uint64_t handled = 0;
+    uint64_t dropped = 0;
+    std::chrono::steady_clock::duration lagPeak{}; // Longest queue wait since the last publish
+    bool warnedFull = false;
+};
+static InterpreterThread interpreter;
+
+// Runs call on the main thread: right away without the interpreter thread,
+// otherwise at the next tick, without waiting for it
+static void post(std::function<void()> call) {
+    if (!interpreter.enabled) {
+        call();
+        return;
+    }
+    std::lock_guard<std::mutex> guard(interpreter.lock);
+    if (!interpreter.stopping) interpreter.calls.push_back(std::move(call));
+}
+
+// Like post, but waits for the result; fallback once the plugin is stopping.
+// The GIL is released while waiting, call may reference the caller's locals
+template <typename T>
+static T call_host(const std::function<T()>& call, T fallback) {
+    if (!interpreter.enabled) return call();
+
+    T result = fallback;
+    bool done = false;
+    PyThreadState* saved = PyEval_SaveThread();
+    {
+        std::unique_lock<std::mutex> guard(interpreter.lock);
+        if (!interpreter.stopping) {
+            interpreter.calls.push_back([&] {
+                T value = call();
+                std::lock_guard<std::mutex> answer(interpreter.lock);
+                result = std::move(value);
+                done = true;
+                interpreter.answered.notify_all();
+            });
+            interpreter.answered.wait(guard, [&] { return done || interpreter.stopping; });
+        }
+    }
+    PyEval_RestoreThread(saved);
+    return result;
+}
+
+// Writes return True once posted; the host refusing one is logged instead
+static PyObject* write_call(const std::string& what, std::function<bool()> call) {
+    if (!interpreter.enabled) {
+        if (call()) Py_RETURN_TRUE;
+        Py_RETURN_FALSE;
+    }
+    post([what, call = std::move(call)] {
+        if (!call()) plugin::host->log("WARN", ("[Python] Host refused " + what).c_str());
+    });
+    Py_RETURN_TRUE;
+}
+
+// A DataValue whose string or bytes live as long as it does, for posted calls
+struct OwnedValue {
+    DataValue value = plugin::no_value();
+    std::string bytes;
+
+    OwnedValue() = default;
+    explicit OwnedValue(const DataValue& v) : value(v) {
+        if (v.type == DATA_STRING || v.type == DATA_BYTES) bytes.assign((const char*)v.data, v.size);
+    }
+    OwnedValue(const OwnedValue& other) : OwnedValue(other.get()) {}
+    OwnedValue& operator=(const OwnedValue& other) {
+        value = other.value;
+        bytes = other.bytes;
+        return *this;
+    }
+
+    DataValue get() const {
+        DataValue v = value;
+        if (v.type == DATA_STRING || v.type == DATA_BYTES) v.data = bytes.data();
+        return v;
+    }
+};
+
 struct ScriptState {
     std::filesystem::file_time_type last_write;
     std::string module_name;
@@ -42,34 +172,61 @@ void check_hot_reload() {
     }
 }
 
-// Proxy for events
-expose void python_event_proxy(const char* eventName, const char* payload) {
-    PyGILState_STATE gstate = PyGILState_Ensure();
+static void forget_target(uint64_t token) {
+    auto found = python_targets.find(token);
+    if (found == python_targets.end()) return;
+    if (found->second.timerId) python_timers.erase(found->second.timerId);
+    Py_DECREF(found->second.callable);
+    python_targets.erase(found);
+}
 
-    auto range = python_event_listeners.equal_range(eventName);
-    for (auto it = range.first; it != range.second; ++it) {
-        PyObject* func = it->second;
-        if (func && PyCallable_Check(func)) {
-            PyObject* args = Py_BuildValue("(ss)", eventName, payload);
-            PyObject* result = PyObject_CallObject(func, args);
-
-            if (result == NULL) {
-                fprintf(stderr, "[Python Error in %s]:\n", eventName);
-                PyErr_Print();
-            } else {
-                Py_DECREF(result);
-            }
-            Py_DECREF(args);
-        }
+static void call_target(uint64_t token, const char* eventName, const char* payload) {
+    auto found = python_targets.find(token);
+    if (found == python_targets.end()) return;
+
+    // Held across the call, the callable may cancel its own timer
+    PyObject* func = found->second.callable;
+    Py_INCREF(func);
+    if (found->second.once) forget_target(token);
+
+    PyObject* args = Py_BuildValue("(ss)", eventName, payload);
+    PyObject* result = PyObject_CallObject(func, args);
+
+    if (result == NULL) {
+        fprintf(stderr, "[Python Error in %s]:\n", eventName);
+        PyErr_Print();
+    } else {
+        Py_DECREF(result);
     }
+    Py_DECREF(args);
+    Py_DECREF(func);
+}
 
-    PyGILState_Release(gstate);
+// Host handler for events and timers, userdata is the target's token
+static void python_handler(void* userdata, const char* eventName, const char* payload) {
+    uint64_t token = (uint64_t)(uintptr_t)userdata;
+    if (!interpreter.enabled) {
+        PyGILState_STATE gstate = PyGILState_Ensure();
+        call_target(token, eventName, payload);
+        PyGILState_Release(gstate);
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(interpreter.lock);
+    if (interpreter.stopping) return;
+    if (interpreter.events.size() >= interpreter.capacity) {
+        interpreter.events.pop_front();
+        interpreter.dropped++;
+    }
+    interpreter.events.push_back({token, eventName, payload ? payload : "", payload != nullptr,
+                                  std::chrono::steady_clock::now()});
+    interpreter.wake.notify_one();
 }
 
 static PyObject* py_log(PyObject* self, PyObject* args) {
     const char *lvl, *msg;
     if (!PyArg_ParseTuple(args, "ss", &lvl, &msg)) return NULL;
-    if (plugin::host) plugin::host->log(lvl, msg);
+    post([level = std::string(lvl), text = std::string(msg)] { plugin::host->log(level.c_str(), text.c_str()); });
     Py_RETURN_NONE;
 }
 
@@ -78,12 +235,13 @@ static PyObject* py_on(PyObject* self, PyObject* args) {
     PyObject* callback;
     if (!PyArg_ParseTuple(args, "sO", &event, &callback)) return NULL;
 
-    if (python_event_listeners.find(event) == python_event_listeners.end()) {
-        if (plugin::host) plugin::host->register_event(event, python_event_proxy);
-    }
-
+    uint64_t token = next_token++;
     Py_INCREF(callback);
-    python_event_listeners.insert({event, callback});
+    python_targets[token] = {callback, 0, false};
+    post([name = std::string(event), token] {
+        uint64_t handle = plugin::subscribe(name.c_str(), python_handler, (void*)(uintptr_t)token);
+        if (handle) python_subscriptions.push_back(handle);
+    });
     Py_RETURN_NONE;
 }
 
@@ -91,27 +249,23 @@ static PyObject* py_send_event(PyObject* self, PyObject* args) {
     const char* event;
     const char* payload;
     if (!PyArg_ParseTuple(args, "ss", &event, &payload)) return NULL;
-    if (plugin::host && plugin::host->send_event) plugin::host->send_event(event, payload);
+    post([name = std::string(event), text = std::string(payload)] {
+        plugin::host->send_event(name.c_str(), text.c_str());
+    });
     Py_RETURN_NONE;
 }
 
 static PyObject* py_load_plugin(PyObject* self, PyObject* args) {
     const char* name;
     if (!PyArg_ParseTuple(args, "s", &name)) return NULL;
-    if (plugin::host && plugin::host->load_plugin) {
-        if (plugin::host->load_plugin(name)) Py_RETURN_TRUE;
-        else Py_RETURN_FALSE;
-    }
+    if (call_host<bool>([&] { return plugin::host->load_plugin(name); }, false)) Py_RETURN_TRUE;
     Py_RETURN_FALSE;
 }
 
 static PyObject* py_unload_plugin(PyObject* self, PyObject* args) {
     const char* name;
     if (!PyArg_ParseTuple(args, "s", &name)) return NULL;
-    if (plugin::host && plugin::host->unload_plugin) {
-        if (plugin::host->unload_plugin(name)) Py_RETURN_TRUE;
-        else Py_RETURN_FALSE;
-    }
+    if (call_host<bool>([&] { return plugin::host->unload_plugin(name); }, false)) Py_RETURN_TRUE;
     Py_RETURN_FALSE;
 }
 
@@ -119,43 +273,153 @@ static PyObject* py_set_data(PyObject* self, PyObject* args) {
     const char* key;
     const char* value;
     if (!PyArg_ParseTuple(args, "ss", &key, &value)) return NULL;
-    if (plugin::host && plugin::host->set_data) {
-        if (plugin::host->set_data(key, value)) Py_RETURN_TRUE;
-        else Py_RETURN_FALSE;
-    }
-    Py_RETURN_FALSE;
+    return write_call("set_data(" + std::string(key) + ")", [k = std::string(key), v = std::string(value)] {
+        return plugin::host->set_data(k.c_str(), v.c_str());
+    });
 }
 
 static PyObject* py_get_data(PyObject* self, PyObject* args) {
     const char* key;
     if (!PyArg_ParseTuple(args, "s", &key)) return NULL;
-    if (plugin::host && plugin::host->get_data) {
-        const char* value = plugin::host->get_data(key);
-        if (value) return PyUnicode_FromString(value);
-    }
+    std::optional<std::string> value = call_host<std::optional<std::string>>([&]() -> std::optional<std::string> {
+        const char* stored = plugin::host->get_data(key);
+        if (!stored) return std::nullopt;
+        return std::string(stored);
+    }, std::nullopt);
+    if (value) return PyUnicode_FromStringAndSize(value->data(), (Py_ssize_t)value->size());
     Py_RETURN_NONE;
 }
 
 static PyObject* py_has_data(PyObject* self, PyObject* args) {
     const char* key;
     if (!PyArg_ParseTuple(args, "s", &key)) return NULL;
-    if (plugin::host && plugin::host->has_data) {
-        if (plugin::host->has_data(key)) Py_RETURN_TRUE;
-        else Py_RETURN_FALSE;
-    }
+    if (call_host<bool>([&] { return plugin::host->has_data(key); }, false)) Py_RETURN_TRUE;
     Py_RETURN_FALSE;
 }
 
 static PyObject* py_delete_data(PyObject* self, PyObject* args) {
     const char* key;
     if (!PyArg_ParseTuple(args, "s", &key)) return NULL;
-    if (plugin::host && plugin::host->delete_data) {
-        if (plugin::host->delete_data(key)) Py_RETURN_TRUE;
-        else Py_RETURN_FALSE;
+    return write_call("delete_data(" + std::string(key) + ")", [k = std::string(key)] {
+        return plugin::host->delete_data(k.c_str());
+    });
+}
+
+// int -> DATA_INT64, float -> DATA_DOUBLE, bytes -> DATA_BYTES, str -> DATA_STRING, None -> DATA_NONE.
+// String and bytes values point into obj and are only valid while it lives
+static bool to_data_value(PyObject* obj, DataValue& out) {
+    out = plugin::no_value();
+    if (obj == Py_None) return true;
+    if (PyLong_Check(obj)) {
+        out = plugin::int_value(PyLong_AsLongLong(obj));
+        return !PyErr_Occurred();
+    }
+    if (PyFloat_Check(obj)) {
+        out = plugin::double_value(PyFloat_AsDouble(obj));
+        return true;
     }
+    if (PyBytes_Check(obj)) {
+        out = plugin::bytes_value(PyBytes_AS_STRING(obj), (uint32_t)PyBytes_GET_SIZE(obj));
+        return true;
+    }
+    if (PyUnicode_Check(obj)) {
+        Py_ssize_t size;
+        const char* text = PyUnicode_AsUTF8AndSize(obj, &size);
+        if (!text) return false;
+        out = {DATA_STRING, (uint32_t)size, 0, 0.0, text};
+        return true;
+    }
+    PyErr_SetString(PyExc_TypeError, "value must be int, float, str, bytes or None");
+    return false;
+}
+
+static PyObject* from_data_value(const DataValue& value) {
+    switch (value.type) {
+        case DATA_INT64: return PyLong_FromLongLong(value.i);
+        case DATA_DOUBLE: return PyFloat_FromDouble(value.d);
+        case DATA_BYTES: return PyBytes_FromStringAndSize((const char*)value.data, value.size);
+        case DATA_STRING: return PyUnicode_FromStringAndSize((const char*)value.data, value.size);
+        default: Py_RETURN_NONE;
+    }
+}
+
+static bool require_typed_data() {
+    if (plugin::has_feature(HOST_FEATURE_TYPED_DATA)) return true;
+    PyErr_SetString(PyExc_RuntimeError, "host does not support typed data");
+    return false;
+}
+
+static PyObject* py_set_value(PyObject* self, PyObject* args) {
+    const char* key;
+    PyObject* obj;
+    DataValue value;
+    if (!PyArg_ParseTuple(args, "sO", &key, &obj) || !to_data_value(obj, value)) return NULL;
+    if (!require_typed_data()) return NULL;
+    return write_call("set_value(" + std::string(key) + ")", [k = std::string(key), v = OwnedValue(value)] {
+        DataValue stored = v.get();
+        return plugin::host->set_value(k.c_str(), &stored);
+    });
+}
+
+static PyObject* py_get_value(PyObject* self, PyObject* args) {
+    const char* key;
+    if (!PyArg_ParseTuple(args, "s", &key)) return NULL;
+    if (!require_typed_data()) return NULL;
+    OwnedValue value = call_host<OwnedValue>([&] {
+        DataValue stored = plugin::no_value();
+        plugin::host->get_value(key, &stored);
+        return OwnedValue(stored);
+    }, OwnedValue());
+    return from_data_value(value.get());
+}
+
+static PyObject* py_add(PyObject* self, PyObject* args) {
+    const char* key;
+    PyObject* obj;
+    DataValue delta, result = plugin::no_value();
+    if (!PyArg_ParseTuple(args, "sO", &key, &obj) || !to_data_value(obj, delta)) return NULL;
+    if (!require_typed_data()) return NULL;
+    if (!call_host<bool>([&] { return plugin::host->add_value(key, &delta, &result); }, false)) {
+        PyErr_SetString(PyExc_TypeError, "add needs an int or float matching the stored type");
+        return NULL;
+    }
+    return from_data_value(result);
+}
+
+static PyObject* py_compare_and_swap(PyObject* self, PyObject* args) {
+    const char* key;
+    PyObject *expectedObj, *desiredObj;
+    DataValue expected, desired;
+    if (!PyArg_ParseTuple(args, "sOO", &key, &expectedObj, &desiredObj) ||
+        !to_data_value(expectedObj, expected) || !to_data_value(desiredObj, desired)) return NULL;
+    if (!require_typed_data()) return NULL;
+    if (call_host<bool>([&] { return plugin::host->compare_and_swap(key, &expected, &desired); }, false)) Py_RETURN_TRUE;
     Py_RETURN_FALSE;
 }
 
+static PyObject* py_exchange(PyObject* self, PyObject* args) {
+    const char* key;
+    PyObject* obj;
+    DataValue value, previous = plugin::no_value();
+    if (!PyArg_ParseTuple(args, "sO", &key, &obj) || !to_data_value(obj, value)) return NULL;
+    if (!require_typed_data()) return NULL;
+    if (!call_host<bool>([&] { return plugin::host->exchange_value(key, &value, &previous); }, false)) {
+        PyErr_SetString(PyExc_TypeError, "exchange needs an int or float and a numeric or missing key");
+        return NULL;
+    }
+    return from_data_value(previous);
+}
+
+static PyObject* py_expire(PyObject* self, PyObject* args) {
+    const char* key;
+    uint32_t ms;
+    if (!PyArg_ParseTuple(args, "sI", &key, &ms)) return NULL;
+    if (!require_typed_data()) return NULL;
+    return write_call("expire(" + std::string(key) + ")", [k = std::string(key), ms] {
+        return plugin::host->expire_data(k.c_str(), ms);
+    });
+}
+
 static PyObject* py_set_timer(PyObject* self, PyObject* args) {
     uint32_t ms;
     PyObject* callback;
@@ -166,23 +430,43 @@ static PyObject* py_set_timer(PyObject* self, PyObject* args) {
         return NULL;
     }
 
-    if (plugin::host && plugin::host->set_timer) {
-        uint64_t id = plugin::host->set_timer(ms, python_event_proxy, repeat != 0);
-        return PyLong_FromUnsignedLongLong(id);
-    }
-    Py_RETURN_NONE;
+    uint64_t token = next_token++;
+    void* userdata = (void*)(uintptr_t)token;
+    uint64_t id = call_host<uint64_t>([&] { return plugin::schedule(ms, python_handler, userdata, repeat != 0); }, 0);
+    if (!id) Py_RETURN_NONE;
+
+    Py_INCREF(callback);
+    python_targets[token] = {callback, id, repeat == 0};
+    python_timers[id] = token;
+    return PyLong_FromUnsignedLongLong(id);
 }
 
 static PyObject* py_cancel_timer(PyObject* self, PyObject* args) {
     uint64_t timer_id;
     if (!PyArg_ParseTuple(args, "K", &timer_id)) return NULL;
-    if (plugin::host && plugin::host->cancel_timer) {
-        if (plugin::host->cancel_timer(timer_id)) Py_RETURN_TRUE;
-        else Py_RETURN_FALSE;
-    }
+    bool cancelled = call_host<bool>([&] { return plugin::host->cancel_timer(timer_id); }, false);
+
+    // A firing still queued for the interpreter thread is skipped too
+    auto found = python_timers.find(timer_id);
+    if (found != python_timers.end()) forget_target(found->second);
+    if (cancelled) Py_RETURN_TRUE;
     Py_RETURN_FALSE;
 }
 
+// The host clock is safe to read from any thread
+static PyObject* py_now_ms(PyObject* self, PyObject* args) {
+    return PyLong_FromUnsignedLongLong(plugin::now_ms());
+}
+
+static PyObject* py_event_policy(PyObject* self, PyObject* args) {
+    const char* name;
+    unsigned int policy, windowMs = 0;
+    if (!PyArg_ParseTuple(args, "sI|I", &name, &policy, &windowMs)) return NULL;
+    return write_call("event_policy(" + std::string(name) + ")", [n = std::string(name), policy, windowMs] {
+        return plugin::policy(n.c_str(), policy, windowMs);
+    });
+}
+
 // method table
 static PyMethodDef HostMethods[] = {
     {"log", py_log, METH_VARARGS, ""},
@@ -194,8 +478,16 @@ static PyMethodDef HostMethods[] = {
     {"get_data", py_get_data, METH_VARARGS, ""},
     {"has_data", py_has_data, METH_VARARGS, ""},
     {"delete_data", py_delete_data, METH_VARARGS, ""},
+    {"set_value", py_set_value, METH_VARARGS, ""},
+    {"get_value", py_get_value, METH_VARARGS, ""},
+    {"add", py_add, METH_VARARGS, ""},
+    {"compare_and_swap", py_compare_and_swap, METH_VARARGS, ""},
+    {"exchange", py_exchange, METH_VARARGS, ""},
+    {"expire", py_expire, METH_VARARGS, ""},
     {"set_timer", py_set_timer, METH_VARARGS, ""},
     {"cancel_timer", py_cancel_timer, METH_VARARGS, ""},
+    {"now_ms", py_now_ms, METH_NOARGS, ""},
+    {"event_policy", py_event_policy, METH_VARARGS, ""},
     {NULL, NULL, 0, NULL}
 };
 
@@ -203,16 +495,7 @@ static PyMethodDef HostMethods[] = {
 static struct PyModuleDef host_module = { PyModuleDef_HEAD_INIT, "host", NULL, -1, HostMethods };
 PyMODINIT_FUNC PyInit_host(void) { return PyModule_Create(&host_module); }
 
-api bool plugin_init(PluginHost* host) {
-    sethost();
-
-    if (PyImport_AppendInittab("host", PyInit_host) == -1) {
-        plugin::host->log("ERROR", "Could not extend python inittab");
-        return false;
-    }
-
-    Py_Initialize();
-
+static void import_scripts() {
     PyRun_SimpleString(
         "import sys, os\n"
         "sys.path.append(os.path.abspath('plugins/python'))\n"
@@ -227,14 +510,14 @@ api bool plugin_init(PluginHost* host) {
 
                 std::string moduleName = entry.path().stem().string();
                 
-                plugin::host->log("INFO", ("Importing Module: " + moduleName).c_str());
+                post([moduleName] { plugin::host->log("INFO", ("Importing Module: " + moduleName).c_str()); });
 
                 PyObject* pName = PyUnicode_FromString(moduleName.c_str());
                 PyObject* pModule = PyImport_Import(pName);
                 
                 if (pModule == nullptr) {
                     PyErr_Print();
-                    plugin::host->log("ERROR", ("Failed to load: " + moduleName).c_str());
+                    post([moduleName] { plugin::host->log("ERROR", ("Failed to load: " + moduleName).c_str()); });
                 } else {
                     Py_DECREF(pModule);
                 }
@@ -242,23 +525,168 @@ api bool plugin_init(PluginHost* host) {
             }
         }
     }
+}
+
+static void release_targets() {
+    for (auto& pair : python_targets) {
+        Py_DECREF(pair.second.callable);
+    }
+    python_targets.clear();
+}
+
+// The worker owns the interpreter from Py_Initialize to Py_Finalize
+static void interpreter_main() {
+    Py_Initialize();
+    import_scripts();
+
+    for (;;) {
+        QueuedEvent event;
+        PyThreadState* saved = PyEval_SaveThread();
+        {
+            std::unique_lock<std::mutex> guard(interpreter.lock);
+            interpreter.wake.wait(guard, [] { return interpreter.stopping || !interpreter.events.empty(); });
+            if (interpreter.stopping) {
+                guard.unlock();
+                PyEval_RestoreThread(saved);
+                break;
+            }
+            event = std::move(interpreter.events.front());
+            interpreter.events.pop_front();
+            interpreter.lagPeak = std::max(interpreter.lagPeak, std::chrono::steady_clock::now() - event.queued);
+        }
+        PyEval_RestoreThread(saved);
+
+        call_target(event.token, event.name.c_str(), event.hasPayload ? event.payload.c_str() : nullptr);
+
+        std::lock_guard<std::mutex> guard(interpreter.lock);
+        interpreter.handled++;
+    }
+
+    release_targets();
+    Py_Finalize();
+}
+
+// Main thread, every frame: runs what the worker posted and publishes the queue figures
+static void run_posted_calls(const char*, const char*) {
+    std::deque<std::function<void()>> calls;
+    uint64_t handled, dropped;
+    size_t depth;
+    double lag;
+    bool full = false;
+    {
+        std::lock_guard<std::mutex> guard(interpreter.lock);
+        calls.swap(interpreter.calls);
+
+        // A handler that never returns shows up as the age of the oldest waiting event
+        auto now = std::chrono::steady_clock::now();
+        auto waited = interpreter.events.empty() ? interpreter.lagPeak
+                                                 : std::max(interpreter.lagPeak, now - interpreter.events.front().queued);
+        lag = std::chrono::duration<double>(waited).count();
+        interpreter.lagPeak = {};
+        handled = interpreter.handled;
+        dropped = interpreter.dropped;
+        depth = interpreter.events.size();
+        if (dropped && !interpreter.warnedFull) full = interpreter.warnedFull = true;
+    }
+
+    for (auto& call : calls) call();
+
+    plugin::gauge("python_queue_depth", (double)depth);
+    plugin::gauge("python_queue_lag_seconds", lag);
+    plugin::counter("python_events_handled_total", (double)handled);
+    plugin::counter("python_events_dropped_total", (double)dropped);
+    if (full) {
+        plugin::host->log("WARN", ("[Python] Event queue full at " + std::to_string(interpreter.capacity) +
+                                   ", dropping the oldest events").c_str());
+    }
+}
+
+static void configure(const std::vector<std::string>& entries) {
+    interpreter.enabled = false;
+    interpreter.capacity = 1024;
+    interpreter.handled = interpreter.dropped = 0;
+    interpreter.warnedFull = false;
+
+    for (const auto& entry : entries) {
+        size_t eq_pos = entry.find('=');
+        if (eq_pos == std::string::npos) continue;
+
+        std::string key = entry.substr(0, eq_pos);
+        std::string value = entry.substr(eq_pos + 1);
+
+        try {
+            if (key == "thread") interpreter.enabled = value == "true" || value == "1" || value == "on";
+            else if (key == "queue") interpreter.capacity = std::max<size_t>(1, std::stoul(value));
+            else plugin::host->log("WARN", ("[Python] Unknown entry: " + entry).c_str());
+        } catch (...) {
+            plugin::host->log("WARN", ("[Python] Ignoring invalid entry: " + entry).c_str());
+        }
+    }
+}
+
+// Main thread, with the interpreter idle: afterwards the host holds no tokens
+static void drop_registrations() {
+    for (uint64_t handle : python_subscriptions) plugin::unsubscribe(handle);
+    python_subscriptions.clear();
+    for (auto& pair : python_timers) plugin::host->cancel_timer(pair.first);
+    python_timers.clear();
+}
+
+api bool plugin_init(PluginHost* host) {
+    sethost();
+
+    if (!plugin::has_feature(HOST_FEATURE_USERDATA)) {
+        plugin::host->log("ERROR", "[Python] The host has no subscribe/schedule, update the runtime");
+        return false;
+    }
+
+    if (PyImport_AppendInittab("host", PyInit_host) == -1) {
+        plugin::host->log("ERROR", "Could not extend python inittab");
+        return false;
+    }
+
+    configure(parse_ini("plugins.ini", "PYTHON"));
+    if (interpreter.enabled) {
+        // Scripts import on the worker; what they register takes effect from the next tick
+        interpreter.stopping = false;
+        plugin::host->register_event("tick", run_posted_calls);
+        interpreter.worker = std::thread(interpreter_main);
+        plugin::host->log("INFO", ("[Python] Interpreter thread started, queue of " +
+                                   std::to_string(interpreter.capacity) + " events").c_str());
+        return true;
+    }
+
+    Py_Initialize();
+    import_scripts();
     return true;
 }
 
 api void plugin_shutdown() {
     plugin::host->log("INFO", "Python Loader shutting down...");
 
-    if (plugin::host) {
-        plugin::host->unregister_event(python_event_proxy);
+    if (interpreter.enabled) {
+        plugin::host->unregister_event(run_posted_calls);
+        {
+            std::lock_guard<std::mutex> guard(interpreter.lock);
+            interpreter.stopping = true;
+        }
+        interpreter.wake.notify_all();
+        interpreter.answered.notify_all();
+
+        // Waits for the handler in progress, if any; queued events and posted calls are dropped
+        if (interpreter.worker.joinable()) interpreter.worker.join();
+        drop_registrations();
+        interpreter.events.clear();
+        interpreter.calls.clear();
+        plugin::host = nullptr;
+        return;
     }
 
+    drop_registrations();
     PyGILState_STATE gstate = PyGILState_Ensure();
-    for (auto& pair : python_event_listeners) {
-        Py_DECREF(pair.second);
-    }
-    python_event_listeners.clear();
+    release_targets();
     PyGILState_Release(gstate);
 
     Py_Finalize();
     plugin::host = nullptr;
-}
\ No newline at end of file
+}
@@ -7,6 +7,13 @@ INFO = "INFO"
 WARN = "WARN"
 ERROR = "ERROR"
 
+# event_policy
+IMMEDIATE = 0
+LATEST = 1
+KEYED = 2
+DEBOUNCE = 3
+THROTTLE = 4
+
 def log(msg, level=INFO):
     host.log(level, str(msg))
 
@@ -51,6 +58,30 @@ def delete_data(key):
     """Delete a key from host storage. Returns True if deleted."""
     return host.delete_data(str(key))
 
+def set_value(key, value):
+    """Store an int, float, str or bytes value keeping its type."""
+    return host.set_value(str(key), value)
+
+def get_value(key):
+    """Get a typed value from host storage, or None."""
+    return host.get_value(str(key))
+
+def add(key, delta=1):
+    """Atomically add to an int or float value, starting at 0. Returns the new value."""
+    return host.add(str(key), delta)
+
+def compare_and_swap(key, expected, desired):
+    """Set key to desired only if it currently holds expected (None for missing)."""
+    return host.compare_and_swap(str(key), expected, desired)
+
+def exchange(key, value):
+    """Atomically replace a number, returning the previous value or None."""
+    return host.exchange(str(key), value)
+
+def expire(key, ms):
+    """Delete key after ms milliseconds, 0 removes the expiry."""
+    return host.expire(str(key), int(ms))
+
 def set_timer(ms, callback, repeat=False):
     """Set a timer in milliseconds. Returns the timer ID."""
     return host.set_timer(int(ms), callback, repeat)
@@ -58,3 +89,11 @@ def set_timer(ms, callback, repeat=False):
 def cancel_timer(timer_id):
     """Cancel a timer by its ID. Returns True if canceled."""
     return host.cancel_timer(timer_id)
+
+def now_ms():
+    """The host clock timers run on, in milliseconds. Simulated under --virtual."""
+    return host.now_ms()
+
+def event_policy(event, policy, window_ms=0):
+    """Deliver event LATEST, KEYED, DEBOUNCE or THROTTLE (window_ms) at the end of the frame."""
+    return host.event_policy(str(event), int(policy), int(window_ms))
@@ -3,9 +3,14 @@
 #include <fstream>
 #include <chrono>
 #include <unordered_map>
+#include <unordered_set>
 #include <functional>
 #include <vector>
 #include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+#include <queue>
 
 // Define plugin directory 
 #ifdef _WIN32
@@ -17,147 +22,1018 @@
 #include "plugin_api.h"
 #include "ini.h"
 #include "ABI_compat_layer.h"
+#include "trace.h"
+#include "log.h"
+#include "plugin_index.h"
+#include "storage.h"
+#include "budget.h"
+#include "memory.h"
+#include "metrics.h"
+#include "clock.h"
+
+#define PLUGIN_INDEX_FILE PLUGIN_DIR ".index"
+
+// Per-plugin host state, kept by name so addresses survive reloads
+struct PluginContext {
+    std::string name;
+    LogSource* log;
+    StoragePartition* storage;
+    PluginBudget* budget;
+    PluginArena* memory;
+    uint32_t active = 0; // Callbacks on the main thread's stack, unloading waits for them
+};
+
+Storage STORAGE;
+
+static std::unordered_map<std::string, PluginContext> PLUGIN_CONTEXTS;
+
+PluginContext* plugin_context(const std::string& name) {
+    auto it = PLUGIN_CONTEXTS.find(name);
+    if (it == PLUGIN_CONTEXTS.end()) {
+        it = PLUGIN_CONTEXTS.emplace(name, PluginContext{name, LOGGER.source(name), STORAGE.partition(name), BUDGETS.budget(name), MEMORY.arena(name)}).first;
+    }
+    return &it->second;
+}
+
+// Plugin whose code is running on this thread, host calls are attributed to it
+thread_local PluginContext* CURRENT_PLUGIN = nullptr;
+
+struct PluginScope {
+    PluginContext* prev;
+    PluginScope(PluginContext* ctx) : prev(CURRENT_PLUGIN) { if (ctx) CURRENT_PLUGIN = ctx; }
+    ~PluginScope() { CURRENT_PLUGIN = prev; }
+};
+
+// Plugin callbacks on this thread's stack. Whatever they send, from a handler,
+// timer or watch alike, is recorded as nested: a replay runs them again
+thread_local int CALLBACK_DEPTH = 0;
+
+// Plugin code called by the host, attributed to ctx and timed against its budget
+struct CallbackScope {
+    PluginScope plugin;
+    BudgetScope budget;
+    PluginContext* context;
+    CallbackScope(PluginContext* ctx, const char* what, bool enforce = true)
+        : plugin(ctx), budget(ctx ? ctx->budget : nullptr, what, enforce), context(ctx) {
+        if (context) context->active++;
+        CALLBACK_DEPTH++;
+    }
+    ~CallbackScope() {
+        if (context) context->active--;
+        CALLBACK_DEPTH--;
+    }
+};
+
+static bool deprioritized(const PluginContext* ctx) {
+    return ctx && ctx->budget->deprioritized.load(std::memory_order_relaxed);
+}
 
 // Global event transport and storage
+// Either a plain callback or, from subscribe, a handler with its userdata and handle
+struct Listener {
+    event_callback_t callback;
+    PluginContext* owner;
+    event_handler_t handler = nullptr;
+    void* userdata = nullptr;
+    uint64_t handle = 0;
+
+    bool live() const { return callback || handler; }
+    bool same(const Listener& other) const {
+        return callback == other.callback && handle == other.handle && owner == other.owner;
+    }
+    void operator()(const char* eventName, const char* payload) const {
+        if (handler) handler(userdata, eventName, payload);
+        else callback(eventName, payload);
+    }
+};
+
+struct TypedListener {
+    typed_callback_t callback;
+    PluginContext* owner;
+
+    bool live() const { return callback != nullptr; }
+};
+
+// An event waiting for the end of the frame under a delivery policy
+struct HeldEvent {
+    std::string payload; // Text, or the struct bytes of a typed event
+    bool typed;
+    uint64_t layoutHash;
+};
+
+// Delivery policy of one event name, from [EVENTS] or set_event_policy.
+// Text and typed events of the name share it
+struct CoalescedTopic {
+    uint32_t policy = EVENT_POLICY_IMMEDIATE;
+    uint32_t windowMs = 0;
+    std::vector<HeldEvent> held;                       // In order of first send
+    std::unordered_map<std::string, size_t> heldIndex; // Coalescing key -> position in held
+    Clock::time_point lastSend;   // DEBOUNCE: the window restarts with every send
+    Clock::time_point nextWindow; // THROTTLE: nothing is delivered before this
+    uint64_t heldTotal = 0;       // Sent while the policy was in force
+    uint64_t collapsed = 0;       // Replaced by a newer event before delivery
+    uint64_t delivered = 0;
+};
+
+// The first registration fixes a typed event's layout until its last listener leaves
+struct TypedTopic {
+    uint64_t layoutHash = 0;
+    uint32_t size = 0;
+    std::vector<TypedListener> listeners;
+    CoalescedTopic* coalesce = nullptr;
+};
+
+// Listeners of one event name and how often it was sent, for the metrics page
+struct EventChannel {
+    std::vector<Listener> listeners;
+    uint64_t sent = 0;
+    CoalescedTopic* coalesce = nullptr; // Set once the name has a policy
+};
+
+static const char* policy_name(uint32_t policy) {
+    switch (policy) {
+        case EVENT_POLICY_LATEST: return "latest";
+        case EVENT_POLICY_KEYED: return "keyed";
+        case EVENT_POLICY_DEBOUNCE: return "debounce";
+        case EVENT_POLICY_THROTTLE: return "throttle";
+        default: return "immediate";
+    }
+}
+
+// "latest", "keyed", "debounce 100", "throttle:50", "immediate"
+static bool parse_policy(const std::string& text, uint32_t& policy, uint32_t& windowMs) {
+    size_t end = text.find_first_of(" :\t");
+    std::string word = text.substr(0, end);
+    windowMs = 0;
+    if (word == "immediate") policy = EVENT_POLICY_IMMEDIATE;
+    else if (word == "latest") policy = EVENT_POLICY_LATEST;
+    else if (word == "keyed") policy = EVENT_POLICY_KEYED;
+    else if (word == "debounce") policy = EVENT_POLICY_DEBOUNCE;
+    else if (word == "throttle") policy = EVENT_POLICY_THROTTLE;
+    else return false;
+
+    if (policy == EVENT_POLICY_DEBOUNCE || policy == EVENT_POLICY_THROTTLE) {
+        size_t digits = end == std::string::npos ? std::string::npos : text.find_first_of("0123456789", end);
+        if (digits == std::string::npos) return false;
+        windowMs = (uint32_t)std::stoul(text.substr(digits));
+    }
+    return true;
+}
+
+// Non-critical event held back for a plugin that keeps overrunning its budget
+struct DeferredEvent {
+    Listener listener;
+    std::string name;
+    std::string payload;
+};
+
 class EventBus {
 public:
-    std::unordered_map<std::string, std::vector<event_callback_t>> listeners;
+    std::unordered_map<std::string, EventChannel> channels;
+    std::unordered_map<std::string, TypedTopic> typedTopics;
+    std::deque<DeferredEvent> deferred;
+    uint64_t deferredDropped = 0;
+    uint64_t undelivered = 0; // Sent with nobody ever registered for them
+    uint64_t typedSent = 0;
+    std::unordered_map<std::string, CoalescedTopic> coalesced;
+
+    // [EVENTS] entries: <event>=<latest|keyed|debounce ms|throttle ms|immediate>
+    void configure(const std::vector<std::string>& entries) {
+        for (const auto& entry : entries) {
+            size_t eq_pos = entry.find('=');
+            if (eq_pos == std::string::npos) continue;
+
+            uint32_t policy, windowMs;
+            bool valid = false;
+            try {
+                valid = parse_policy(entry.substr(eq_pos + 1), policy, windowMs);
+            } catch (...) {}
+            if (valid) set_policy(entry.substr(0, eq_pos).c_str(), policy, windowMs);
+            else log_warn("[EventBus] Ignoring invalid entry: " + entry);
+        }
+    }
+
+    // Later calls replace the policy; events already held keep waiting for the next flush
+    bool set_policy(const char* eventName, uint32_t policy, uint32_t windowMs) {
+        if (policy > EVENT_POLICY_THROTTLE) return false;
+
+        auto inserted = coalesced.try_emplace(eventName);
+        CoalescedTopic& topic = inserted.first->second;
+        if (inserted.second) coalescedOrder.push_back(eventName);
+        if (!inserted.second && topic.policy == policy && topic.windowMs == windowMs) return true;
+
+        topic.policy = policy;
+        topic.windowMs = windowMs;
+        channels[eventName].coalesce = &topic;
+        auto typed = typedTopics.find(eventName);
+        if (typed != typedTopics.end()) typed->second.coalesce = &topic;
+
+        std::string window = windowMs ? " " + std::to_string(windowMs) + " ms" : "";
+        log_info(std::string("[EventBus] ") + eventName + " is delivered " + policy_name(policy) + window +
+                 (CURRENT_PLUGIN ? ", set by " + CURRENT_PLUGIN->name : std::string()));
+        return true;
+    }
 
     void register_event(const char* eventName, event_callback_t cb) {
-        listeners[eventName].push_back(cb);
+        channels[eventName].listeners.push_back({cb, CURRENT_PLUGIN});
+        byCallback[cb].insert(eventName);
+        byOwner[CURRENT_PLUGIN].insert(eventName);
+    }
+
+    // Handles are never reused, a stale one just fails to unsubscribe
+    uint64_t subscribe(const char* eventName, event_handler_t handler, void* userdata) {
+        uint64_t handle = nextHandle++;
+        channels[eventName].listeners.push_back({nullptr, CURRENT_PLUGIN, handler, userdata, handle});
+        byHandle.emplace(handle, eventName);
+        byOwner[CURRENT_PLUGIN].insert(eventName);
+        return handle;
     }
 
+    bool unsubscribe(uint64_t handle) {
+        auto found = byHandle.find(handle);
+        if (found == byHandle.end()) return false;
+        remove_listeners(found->second, [handle](const Listener& l) { return l.handle == handle; });
+        byHandle.erase(found);
+        return true;
+    }
+
+    // Visits only the events cb was registered for
     void unregister_all_by_callback(event_callback_t cb) {
-        for (auto& pair : listeners) {
-            auto& vec = pair.second;
-            vec.erase(std::remove(vec.begin(), vec.end(), cb), vec.end());
+        auto found = byCallback.find(cb);
+        if (found == byCallback.end()) return;
+        for (const std::string& eventName : found->second) {
+            remove_listeners(eventName, [cb](const Listener& l) { return l.callback == cb; });
         }
+        byCallback.erase(found);
+    }
+
+    // Everything owner registered, in time proportional to what it registered
+    size_t remove_owner(PluginContext* owner) {
+        size_t removed = 0;
+        auto owned = byOwner.find(owner);
+        if (owned != byOwner.end()) {
+            for (const std::string& eventName : owned->second) {
+                removed += remove_listeners(eventName, [owner, this](const Listener& l) {
+                    if (l.owner != owner) return false;
+                    if (l.handler) byHandle.erase(l.handle);
+                    else byCallback.erase(l.callback);
+                    return true;
+                });
+            }
+            byOwner.erase(owned);
+        }
+
+        auto typed = typedByOwner.find(owner);
+        if (typed != typedByOwner.end()) {
+            for (const std::string& eventName : typed->second) {
+                removed += remove_typed(eventName, [owner, this](const TypedListener& l) {
+                    if (l.owner != owner) return false;
+                    typedByCallback.erase(l.callback);
+                    return true;
+                });
+            }
+            typedByOwner.erase(typed);
+        }
+
+        if (!deferred.empty()) {
+            deferred.erase(std::remove_if(deferred.begin(), deferred.end(),
+                [owner](const DeferredEvent& ev) { return ev.listener.owner == owner; }), deferred.end());
+        }
+        return removed;
     }
 
     void send_event(const char* eventName, const char* payload) {
-        auto it = listeners.find(eventName);
-        if (it != listeners.end()) {
-            for (auto& cb : it->second) {
-                cb(eventName, payload);
+        // Handlers and timers sending events of their own show up as nested
+        if (ACTIVE_TRACE) ACTIVE_TRACE->record(eventName, payload, dispatchDepth > 0 || CALLBACK_DEPTH > 0);
+
+        auto it = channels.find(eventName);
+        if (it == channels.end()) {
+            undelivered++;
+            return;
+        }
+        it->second.sent++;
+
+        CoalescedTopic* coalesce = it->second.coalesce;
+        if (coalesce && coalesce->policy != EVENT_POLICY_IMMEDIATE) {
+            const char* text = payload ? payload : "";
+            hold(*coalesce, std::string_view(text, strlen(text)), false, 0);
+            return;
+        }
+
+        dispatch(it->second, eventName, payload);
+    }
+
+    // Hands the surviving held events to their listeners. Called once per frame,
+    // events sent meanwhile wait for the next flush
+    void flush_coalesced() {
+        if (coalesced.empty()) return;
+        auto now = CLOCK.now();
+
+        // By index, a handler may give another name a policy
+        for (size_t i = 0; i < coalescedOrder.size(); i++) {
+            std::string name = coalescedOrder[i];
+            CoalescedTopic& topic = coalesced[name];
+            if (topic.held.empty()) continue;
+
+            auto window = std::chrono::milliseconds(topic.windowMs);
+            if (topic.policy == EVENT_POLICY_DEBOUNCE && now - topic.lastSend < window) continue;
+            if (topic.policy == EVENT_POLICY_THROTTLE) {
+                if (now < topic.nextWindow) continue;
+                topic.nextWindow = now + window;
+            }
+
+            std::vector<HeldEvent> batch;
+            batch.swap(topic.held);
+            topic.heldIndex.clear();
+            topic.delivered += batch.size();
+
+            for (const HeldEvent& ev : batch) {
+                if (ev.typed) {
+                    auto typed = typedTopics.find(name);
+                    if (typed != typedTopics.end()) {
+                        dispatch_typed(typed->second, name.c_str(), ev.layoutHash, ev.payload.data(), (uint32_t)ev.payload.size());
+                    }
+                } else {
+                    auto it = channels.find(name);
+                    if (it != channels.end()) dispatch(it->second, name.c_str(), ev.payload.c_str());
+                }
+            }
+        }
+    }
+
+    // When the next debounce or throttle window closes on a held event, for the virtual clock
+    bool next_deadline(Clock::time_point& out) const {
+        bool found = false;
+        for (const auto& pair : coalesced) {
+            const CoalescedTopic& topic = pair.second;
+            if (topic.held.empty()) continue;
+
+            Clock::time_point at;
+            if (topic.policy == EVENT_POLICY_DEBOUNCE) at = topic.lastSend + std::chrono::milliseconds(topic.windowMs);
+            else if (topic.policy == EVENT_POLICY_THROTTLE) at = topic.nextWindow;
+            else continue;
+            if (!found || at < out) out = at;
+            found = true;
+        }
+        return found;
+    }
+
+    // One line per event name with a policy, for the console's events command
+    std::string policy_report() const {
+        std::vector<std::string> names = coalescedOrder;
+        std::sort(names.begin(), names.end());
+
+        std::string out;
+        for (const std::string& name : names) {
+            const CoalescedTopic& topic = coalesced.at(name);
+            out += name + " " + policy_name(topic.policy) +
+                   (topic.windowMs ? " " + std::to_string(topic.windowMs) + " ms" : std::string()) +
+                   " sent " + std::to_string(topic.heldTotal) +
+                   " delivered " + std::to_string(topic.delivered) +
+                   " collapsed " + std::to_string(topic.collapsed) +
+                   " held " + std::to_string(topic.held.size()) + "\n";
+        }
+        return out;
+    }
+
+    void dispatch(EventChannel& channel, const char* eventName, const char* payload) {
+        dispatchDepth++;
+        dispatching++;
+        std::vector<Listener>& vec = channel.listeners;
+        bool budgets = BUDGETS.enabled;
+        bool critical = budgets && BUDGETS.critical(eventName);
+        bool late = false;
+
+        // By index and copied, handlers may register more listeners meanwhile;
+        // removed ones are cleared until the dispatch is over
+        for (size_t i = 0; i < vec.size(); i++) {
+            Listener l = vec[i];
+            if (!l.live()) continue;
+            if (budgets && deprioritized(l.owner)) {
+                if (critical) late = true;
+                else defer(l, eventName, payload);
+                continue;
+            }
+            CallbackScope scope(l.owner, eventName);
+            l(eventName, payload);
+        }
+
+        // Critical events still reach deprioritized plugins, after everyone else
+        if (late) {
+            for (size_t i = 0; i < vec.size(); i++) {
+                Listener l = vec[i];
+                if (!l.live() || !deprioritized(l.owner)) continue;
+                CallbackScope scope(l.owner, eventName);
+                l(eventName, payload);
             }
         }
+        dispatchDepth--;
+        if (--dispatching == 0 && (!cleared.empty() || !clearedTyped.empty())) compact();
+    }
+
+    void defer(const Listener& l, const char* eventName, const char* payload) {
+        if (deferred.size() >= BUDGETS.maxDeferred) {
+            deferred.pop_front();
+            deferredDropped++;
+        }
+        deferred.push_back({l, eventName, payload ? payload : ""});
+    }
+
+    // Delivers held back events, oldest first, for at most defer_ms per frame
+    void run_deferred() {
+        if (deferred.empty()) return;
+        uint64_t start = budget_now_ns();
+
+        while (!deferred.empty() && budget_now_ns() - start < BUDGETS.deferNs) {
+            DeferredEvent ev = std::move(deferred.front());
+            deferred.pop_front();
+
+            // Skip listeners removed since, their code may be gone
+            auto it = channels.find(ev.name);
+            if (it == channels.end()) continue;
+            auto& vec = it->second.listeners;
+            bool registered = std::any_of(vec.begin(), vec.end(), [&](const Listener& l) {
+                return l.live() && l.same(ev.listener);
+            });
+            if (!registered) continue;
+
+            CallbackScope scope(ev.listener.owner, ev.name.c_str());
+            ev.listener(ev.name.c_str(), ev.payload.c_str());
+        }
+    }
+
+    bool register_typed(const char* eventName, uint64_t layoutHash, uint32_t size, typed_callback_t cb) {
+        TypedTopic& topic = typedTopics[eventName];
+        if (!topic.listeners.empty() && (topic.layoutHash != layoutHash || topic.size != size)) {
+            log_error(std::string("[EventBus] Rejected handler for ") + eventName + " from " +
+                      (CURRENT_PLUGIN ? CURRENT_PLUGIN->name : "host") + ": layout differs from the registered one (" +
+                      std::to_string(size) + " vs " + std::to_string(topic.size) + " bytes)");
+            return false;
+        }
+        if (topic.listeners.empty()) {
+            auto policy = coalesced.find(eventName);
+            topic.coalesce = policy != coalesced.end() ? &policy->second : nullptr;
+        }
+        topic.layoutHash = layoutHash;
+        topic.size = size;
+        topic.listeners.push_back({cb, CURRENT_PLUGIN});
+        typedByCallback[cb].insert(eventName);
+        typedByOwner[CURRENT_PLUGIN].insert(eventName);
+        return true;
+    }
+
+    void unregister_typed(typed_callback_t cb) {
+        auto found = typedByCallback.find(cb);
+        if (found == typedByCallback.end()) return;
+        for (const std::string& eventName : found->second) {
+            remove_typed(eventName, [cb](const TypedListener& l) { return l.callback == cb; });
+        }
+        typedByCallback.erase(found);
+    }
+
+    // Not recorded in traces, which hold text events only
+    void send_typed(const char* eventName, uint64_t layoutHash, const void* data, uint32_t size) {
+        auto it = typedTopics.find(eventName);
+        if (it == typedTopics.end()) return;
+        typedSent++;
+
+        if (it->second.layoutHash != layoutHash || it->second.size != size) {
+            log_warn(std::string("[EventBus] Dropped ") + eventName + " from " +
+                     (CURRENT_PLUGIN ? CURRENT_PLUGIN->name : "host") + ": layout mismatch");
+            return;
+        }
+
+        CoalescedTopic* coalesce = it->second.coalesce;
+        if (coalesce && coalesce->policy != EVENT_POLICY_IMMEDIATE) {
+            hold(*coalesce, std::string_view(static_cast<const char*>(data), size), true, layoutHash);
+            return;
+        }
+        dispatch_typed(it->second, eventName, layoutHash, data, size);
+    }
+
+    // Layout checked again, a held event may outlive the listeners it was sent for
+    void dispatch_typed(TypedTopic& topic, const char* eventName, uint64_t layoutHash, const void* data, uint32_t size) {
+        if (topic.layoutHash != layoutHash || topic.size != size) return;
+
+        dispatchDepth++;
+        dispatching++;
+        // As in dispatch(): by index and copied, removed listeners are cleared until the dispatch is over
+        std::vector<TypedListener>& vec = topic.listeners;
+        for (size_t i = 0; i < vec.size(); i++) {
+            TypedListener l = vec[i];
+            if (!l.live()) continue;
+            CallbackScope scope(l.owner, eventName);
+            l.callback(eventName, data, size);
+        }
+        dispatchDepth--;
+        if (--dispatching == 0 && (!cleared.empty() || !clearedTyped.empty())) compact();
+    }
+
+private:
+    // Event names each callback and each owner registered for, so removal
+    // never walks events they have nothing in
+    std::unordered_map<event_callback_t, std::unordered_set<std::string>> byCallback;
+    std::unordered_map<uint64_t, std::string> byHandle; // Subscriptions, unsubscribed in O(1)
+    uint64_t nextHandle = 1;
+    std::unordered_map<PluginContext*, std::unordered_set<std::string>> byOwner;
+    std::unordered_map<typed_callback_t, std::unordered_set<std::string>> typedByCallback;
+    std::unordered_map<PluginContext*, std::unordered_set<std::string>> typedByOwner;
+
+    int dispatching = 0;
+    static thread_local int dispatchDepth;
+    std::unordered_set<std::string> cleared; // Events with listeners cleared mid-dispatch
+    std::unordered_set<std::string> clearedTyped;
+    std::vector<std::string> coalescedOrder; // Names with a policy, flushed in the order they got it
+
+    // A newer event with the same coalescing key replaces the held one in place:
+    // text before the first space for keyed text events, the first 8 bytes of a
+    // keyed struct, and the whole name for the other policies
+    void hold(CoalescedTopic& topic, std::string_view payload, bool typed, uint64_t layoutHash) {
+        topic.heldTotal++;
+        if (topic.policy == EVENT_POLICY_DEBOUNCE) topic.lastSend = CLOCK.now();
+
+        std::string key(1, typed ? 't' : 's');
+        if (topic.policy == EVENT_POLICY_KEYED) {
+            key += typed ? payload.substr(0, 8) : payload.substr(0, payload.find(' '));
+        }
+
+        auto found = topic.heldIndex.find(key);
+        if (found != topic.heldIndex.end()) {
+            HeldEvent& ev = topic.held[found->second];
+            ev.payload.assign(payload.data(), payload.size());
+            ev.layoutHash = layoutHash;
+            topic.collapsed++;
+            return;
+        }
+        topic.heldIndex.emplace(std::move(key), topic.held.size());
+        topic.held.push_back({std::string(payload), typed, layoutHash});
+    }
+
+    template <typename Match>
+    size_t remove_listeners(const std::string& eventName, Match match) {
+        auto it = channels.find(eventName);
+        if (it == channels.end()) return 0;
+
+        size_t removed = 0;
+        for (auto& l : it->second.listeners) {
+            if (l.live() && match(l)) {
+                l.callback = nullptr;
+                l.handler = nullptr;
+                removed++;
+            }
+        }
+        if (removed) {
+            if (dispatching) cleared.insert(eventName);
+            else compact(it->second.listeners);
+        }
+        return removed;
+    }
+
+    template <typename Match>
+    size_t remove_typed(const std::string& eventName, Match match) {
+        auto it = typedTopics.find(eventName);
+        if (it == typedTopics.end()) return 0;
+
+        size_t removed = 0;
+        for (auto& l : it->second.listeners) {
+            if (l.live() && match(l)) {
+                l.callback = nullptr;
+                removed++;
+            }
+        }
+        if (removed) {
+            if (dispatching) clearedTyped.insert(eventName);
+            else compact_typed(it);
+        }
+        return removed;
+    }
+
+    // A topic without listeners goes, the next handler may bring another layout
+    void compact_typed(std::unordered_map<std::string, TypedTopic>::iterator it) {
+        auto& vec = it->second.listeners;
+        vec.erase(std::remove_if(vec.begin(), vec.end(),
+            [](const TypedListener& l) { return !l.live(); }), vec.end());
+        if (vec.empty()) typedTopics.erase(it);
+    }
+
+    static void compact(std::vector<Listener>& vec) {
+        vec.erase(std::remove_if(vec.begin(), vec.end(),
+            [](const Listener& l) { return !l.live(); }), vec.end());
+    }
+
+    void compact() {
+        for (const std::string& eventName : cleared) {
+            auto it = channels.find(eventName);
+            if (it != channels.end()) compact(it->second.listeners);
+        }
+        cleared.clear();
+        for (const std::string& eventName : clearedTyped) {
+            auto it = typedTopics.find(eventName);
+            if (it != typedTopics.end()) compact_typed(it);
+        }
+        clearedTyped.clear();
     }
 };
 
+thread_local int EventBus::dispatchDepth = 0;
+
 // Global bus
 EventBus EVENT_BUS;
 
-// Simple key-value storage
-class Storage {
+// Writes are charged to the calling plugin's partition
+static StoragePartition* current_storage() {
+    return CURRENT_PLUGIN ? CURRENT_PLUGIN->storage : nullptr;
+}
+
+// Allocations are charged to the calling plugin's arena, the host's outside plugin code
+static PluginArena* current_arena() {
+    static PluginArena* hostArena = MEMORY.arena("");
+    return CURRENT_PLUGIN ? CURRENT_PLUGIN->memory : hostArena;
+}
+
+struct DataWatch {
+    uint64_t id;
+    event_callback_t callback;
+    PluginContext* owner;
+};
+
+struct WatchPattern {
+    std::string key;
+    bool prefix;
+    PluginContext* owner;
+};
+
+// Storage subscriptions, a pattern ending in '*' watches every key with that
+// prefix. STORAGE collects each changed key once and flush() delivers them at
+// the end of the frame as callback(key, value), value nullptr once deleted.
+class DataWatchers {
 public:
-    std::unordered_map<std::string, std::string> data;
-    
-    bool set(const char* key, const char* value) {
-        data[key] = value;
-        return true;
+    std::unordered_map<std::string, std::vector<DataWatch>> exact;
+    std::map<std::string, std::vector<DataWatch>, std::less<>> prefixes;
+    std::unordered_map<uint64_t, WatchPattern> patterns;
+    std::unordered_map<PluginContext*, std::unordered_set<uint64_t>> byOwner;
+    uint64_t next_id = 1;
+
+    uint64_t watch(const char* pattern, event_callback_t cb) {
+        std::string key = pattern;
+        bool prefix = !key.empty() && key.back() == '*';
+        if (prefix) key.pop_back();
+
+        uint64_t id = next_id++;
+        (prefix ? prefixes[key] : exact[key]).push_back({id, cb, CURRENT_PLUGIN});
+        patterns[id] = {key, prefix, CURRENT_PLUGIN};
+        byOwner[CURRENT_PLUGIN].insert(id);
+        STORAGE.trackChanges = true;
+        return id;
     }
-    
-    const char* get(const char* key) {
-        auto it = data.find(key);
-        if (it != data.end()) {
-            return it->second.c_str();
+
+    bool unwatch(uint64_t id) {
+        auto it = patterns.find(id);
+        if (it == patterns.end()) return false;
+
+        auto drop = [id](auto& map, const std::string& key) {
+            auto found = map.find(key);
+            if (found == map.end()) return;
+            auto& vec = found->second;
+            vec.erase(std::remove_if(vec.begin(), vec.end(),
+                [id](const DataWatch& w) { return w.id == id; }), vec.end());
+            if (vec.empty()) map.erase(found);
+        };
+        if (it->second.prefix) drop(prefixes, it->second.key);
+        else drop(exact, it->second.key);
+
+        auto owned = byOwner.find(it->second.owner);
+        if (owned != byOwner.end()) {
+            owned->second.erase(id);
+            if (owned->second.empty()) byOwner.erase(owned);
         }
-        return nullptr;
+        patterns.erase(it);
+        STORAGE.trackChanges = !patterns.empty();
+        return true;
     }
-    
-    bool has(const char* key) {
-        return data.find(key) != data.end();
+
+    size_t remove_owner(PluginContext* owner) {
+        auto owned = byOwner.find(owner);
+        if (owned == byOwner.end()) return 0;
+
+        // Copied, unwatch edits the set
+        std::vector<uint64_t> ids(owned->second.begin(), owned->second.end());
+        for (uint64_t id : ids) unwatch(id);
+        return ids.size();
     }
-    
-    bool remove(const char* key) {
-        return data.erase(key) > 0;
+
+    void flush() {
+        if (!STORAGE.trackChanges) return;
+
+        std::vector<DataWatch> targets;
+        for (const std::string& key : STORAGE.take_changes()) {
+            targets.clear();
+            auto it = exact.find(key);
+            if (it != exact.end()) targets = it->second;
+            collect_prefixes(key, targets);
+            if (targets.empty()) continue;
+
+            // Copied, a watcher may write the key again
+            const char* current = STORAGE.get(key.c_str());
+            bool present = current != nullptr;
+            std::string value = present ? current : "";
+
+            for (const DataWatch& w : targets) {
+                // Unwatched by an earlier callback, its plugin may be gone
+                if (!patterns.count(w.id)) continue;
+                CallbackScope scope(w.owner, key.c_str());
+                w.callback(key.c_str(), present ? value.c_str() : nullptr);
+            }
+        }
+    }
+
+private:
+    // Every watched prefix of key with O(log n) lookups per match. The largest
+    // entry <= probe is either a prefix of it, or shares c characters with it
+    // and no longer prefix of probe can be in the map.
+    void collect_prefixes(const std::string& key, std::vector<DataWatch>& out) {
+        std::string_view probe = key;
+        for (;;) {
+            auto it = prefixes.upper_bound(probe);
+            if (it == prefixes.begin()) return;
+            --it;
+
+            const std::string& candidate = it->first;
+            size_t common = 0;
+            while (common < candidate.size() && common < probe.size() && candidate[common] == probe[common]) common++;
+
+            if (common == candidate.size()) {
+                out.insert(out.end(), it->second.begin(), it->second.end());
+                if (common == 0) return;
+                probe = probe.substr(0, common - 1);
+            } else {
+                probe = probe.substr(0, common);
+            }
+        }
     }
 };
 
-Storage STORAGE;
+DataWatchers DATA_WATCHERS;
 
 struct Timer {
     uint64_t id;
     uint32_t interval_ms;
     event_callback_t callback;
+    event_handler_t handler; // From schedule, called with userdata instead of callback
+    void* userdata;
+    PluginContext* owner;
     bool repeat;
-    std::chrono::steady_clock::time_point next_fire;
-    bool active;
+    Clock::time_point next_fire;
 };
 
+// Timers by id, a min-heap of fire times and an index by owner. Cancelled
+// timers leave their heap entry behind, it is skipped when it comes due.
+// Ties go to the lower id, so timers due together fire in the order they were set.
 class TimerManager {
 public:
-    std::vector<Timer> timers;
+    std::unordered_map<uint64_t, Timer> timers;
     uint64_t next_id = 1;
+    uint64_t firedTotal = 0;
     
-    uint64_t add_timer(uint32_t ms, event_callback_t callback, bool repeat) {
+    uint64_t add_timer(uint32_t ms, event_callback_t callback, bool repeat, PluginContext* owner = CURRENT_PLUGIN,
+                       event_handler_t handler = nullptr, void* userdata = nullptr) {
         Timer t;
         t.id = next_id++;
         t.interval_ms = ms;
         t.callback = callback;
+        t.handler = handler;
+        t.userdata = userdata;
+        t.owner = owner;
         t.repeat = repeat;
-        t.next_fire = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
-        t.active = true;
-        timers.push_back(t);
+        t.next_fire = CLOCK.now() + std::chrono::milliseconds(ms);
+        timers.emplace(t.id, t);
+        schedule(t);
+        byOwner[owner].insert(t.id);
         return t.id;
     }
     
     bool cancel_timer(uint64_t id) {
-        for (auto& t : timers) {
-            if (t.id == id) {
-                t.active = false;
+        auto it = timers.find(id);
+        if (it == timers.end()) return false;
+        forget(it);
+        return true;
+    }
+
+    size_t remove_owner(PluginContext* owner) {
+        auto owned = byOwner.find(owner);
+        if (owned == byOwner.end()) return 0;
+
+        size_t removed = owned->second.size();
+        for (uint64_t id : owned->second) timers.erase(id);
+        byOwner.erase(owned);
+        return removed;
+    }
+    
+    // Earliest fire time of a live timer, for the virtual clock. Drops cancelled heap entries on the way
+    bool next_deadline(Clock::time_point& out) {
+        while (!due.empty()) {
+            auto it = timers.find(due.top().second);
+            if (it != timers.end() && it->second.next_fire == due.top().first) {
+                out = due.top().first;
                 return true;
             }
+            due.pop();
         }
         return false;
     }
-    
+
     void update() {
-        auto now = std::chrono::steady_clock::now();
-        
-        for (auto& t : timers) {
-            if (!t.active) continue;
-            
-            if (now >= t.next_fire) {
-                t.callback("timer", "");
-                
-                if (t.repeat) {
-                    t.next_fire = now + std::chrono::milliseconds(t.interval_ms);
-                } else {
-                    t.active = false;
-                }
+        auto now = CLOCK.now();
+
+        // Taken out first so a timer fires at most once per update, even at 0 ms
+        std::vector<Due> fired;
+        while (!due.empty() && due.top().first <= now) {
+            fired.push_back(due.top());
+            due.pop();
+        }
+
+        for (const Due& entry : fired) {
+            auto it = timers.find(entry.second);
+            if (it == timers.end() || it->second.next_fire != entry.first) continue; // Cancelled
+
+            // Copied, the callback may add or cancel timers
+            Timer t = it->second;
+            firedTotal++;
+            {
+                CallbackScope scope(t.owner, "timer");
+                if (t.handler) t.handler(t.userdata, "timer", "");
+                else t.callback("timer", "");
+            }
+
+            it = timers.find(t.id);
+            if (it == timers.end()) continue; // Cancelled itself
+            if (t.repeat) {
+                it->second.next_fire = now + std::chrono::milliseconds(t.interval_ms);
+                schedule(it->second);
+            } else {
+                forget(it);
             }
         }
-        
-        timers.erase(
-            std::remove_if(timers.begin(), timers.end(), 
-                [](const Timer& t) { return !t.active; }),
-            timers.end()
-        );
+
+        // Rebuild once cancelled entries dominate the heap
+        if (due.size() > 64 && due.size() > 2 * timers.size()) {
+            due = {};
+            for (const auto& pair : timers) schedule(pair.second);
+        }
+    }
+
+private:
+    using Due = std::pair<Clock::time_point, uint64_t>;
+    std::priority_queue<Due, std::vector<Due>, std::greater<Due>> due;
+    std::unordered_map<PluginContext*, std::unordered_set<uint64_t>> byOwner;
+
+    void schedule(const Timer& t) {
+        due.push({t.next_fire, t.id});
+    }
+
+    void forget(std::unordered_map<uint64_t, Timer>::iterator it) {
+        auto owned = byOwner.find(it->second.owner);
+        if (owned != byOwner.end()) {
+            owned->second.erase(it->first);
+            if (owned->second.empty()) byOwner.erase(owned);
+        }
+        timers.erase(it);
     }
 };
 
 TimerManager TIMER_MANAGER;
 
+// One-shot host timer armed by every expire_data call
+static void on_storage_expiry(const char* eventName, const char* payload) {
+    STORAGE.expire_due();
+}
+
+PluginIndex PLUGIN_INDEX;
+
 void host_log(const char* level, const char* message) {
-    std::cout << "[" << level << "] " << message << std::endl;
+    LOGGER.write(CURRENT_PLUGIN ? CURRENT_PLUGIN->log : RUNTIME_LOG, level, message);
 }
 
 // Plugin wrapper
+extern const PluginHost PLUGIN_HOST_TABLE;
+
+// Plugins linked into this binary (./compile.sh static), added by their
+// manifest() before main runs
+struct StaticPlugin {
+    std::string file; // <stem>.so or <stem>.dll, as plugins.ini names it
+    plugin_get_info_t getInfo;
+    plugin_init_t init;
+    plugin_shutdown_t shutdown;
+};
+
+static std::vector<StaticPlugin>& static_plugins() {
+    static std::vector<StaticPlugin> list;
+    return list;
+}
+
+bool plugin_link_static(const char* file, plugin_get_info_t getInfo, plugin_init_t init, plugin_shutdown_t shutdown) {
+    static_plugins().push_back({std::string(file) + WINLIN(".dll", ".so"), getInfo, init, shutdown});
+    return true;
+}
+
+static const StaticPlugin* find_static_plugin(const std::string& file) {
+    for (const auto& linked : static_plugins()) {
+        if (linked.file == file) return &linked;
+    }
+    return nullptr;
+}
+
 class Plugin {
 public:
     std::string name;
     PluginHandle handle;
+    PluginContext* context;
+    bool linked; // From the static table, there is no library to close
 
     plugin_get_info_t getInfo;
     plugin_init_t init;
     plugin_shutdown_t shutdown;
 
     Plugin(const std::string& pluginName)
-        : name(pluginName), handle(nullptr),
+        : name(pluginName), handle(nullptr), context(plugin_context(pluginName)), linked(false),
           getInfo(nullptr), init(nullptr), shutdown(nullptr) {}
 
     bool load() {
+        // A linked-in copy wins over a library of the same name
+        if (const StaticPlugin* entry = find_static_plugin(name)) {
+            linked = true;
+            getInfo = entry->getInfo;
+            init = entry->init;
+            shutdown = entry->shutdown;
+        } else if (!open_library()) {
+            return false;
+        }
+
+        const PluginInfo* info = getInfo();
+        if (!info || info->abi_version < ABI_V1 || info->abi_version > ABI_CURRENT) {
+            log_error("Plugin built for unsupported ABI v" + std::to_string(info ? info->abi_version : 0) +
+                      ": " + name);
+            close_library();
+            return false;
+        }
+
+        if (info->abi_version >= ABI_V2) {
+            // Newer plugins must check table_size before using calls this host lacks
+            const PluginInfoV2* v2 = reinterpret_cast<const PluginInfoV2*>(info);
+            if (v2->host_table_size > PLUGIN_HOST_TABLE.table_size) {
+                log_warn("Plugin " + name + " expects a " + std::to_string(v2->host_table_size) +
+                         " byte host table, host provides " + std::to_string(PLUGIN_HOST_TABLE.table_size));
+            }
+        }
+
+        log_info(std::string("Loaded plugin: ") + info->name + " v" + info->version + (linked ? " (static)" : ""));
+
+        bool initialized;
+        {
+            CallbackScope scope(context, "plugin_init", false);
+            initialized = init(const_cast<PluginHost*>(&PLUGIN_HOST_TABLE));
+        }
+        if (!initialized) {
+            log_error("Plugin failed to initialize: " + name);
+            // Whatever init registered before failing goes with the library
+            teardown();
+            return false;
+        }
+
+        // Dependencies registered during init are only visible now
+        PLUGIN_INDEX.update(PLUGIN_DIR, name, info);
+        return true;
+    }
+
+    void unload() {
+        if (handle || linked) {
+            {
+                CallbackScope scope(context, "plugin_shutdown", false);
+                shutdown();
+            }
+
+            teardown();
+            log_info("Unloaded plugin: " + name);
+        }
+    }
+
+    // After shutdown or a failed init. Whatever the plugin did not remove itself
+    // would call into unmapped code; its storage goes after the library, whose
+    // static destructors may still free into the arena
+    void teardown() {
+        size_t leftovers = EVENT_BUS.remove_owner(context) + TIMER_MANAGER.remove_owner(context) +
+                           DATA_WATCHERS.remove_owner(context);
+        if (leftovers) {
+            log_info("[Runtime] Removed " + std::to_string(leftovers) + " handlers, timers and watches left by " + name);
+        }
+        close_library();
+        linked = false;
+        STORAGE.release(context->storage);
+        MEMORY.release(context->memory);
+        PLUGIN_METRICS.remove(name);
+    }
+
+    bool open_library() {
         std::string fullPath = PLUGIN_DIR + name;
         
         handle = PLATFORM_LOAD_LIB(fullPath.c_str());
@@ -165,10 +1041,10 @@ public:
         if (!handle) {
             #ifndef _WIN32
             const char* err = dlerror();
-            if(err) std::cerr << "dlopen error: " << err << std::endl;
+            if(err) log_error(std::string("dlopen error: ") + err);
             #endif
             
-            std::cerr << "Failed to load plugin: " << name << std::endl;
+            log_error("Failed to load plugin: " + name);
             return false;
         }
 
@@ -177,30 +1053,16 @@ public:
         shutdown = (plugin_shutdown_t)PLATFORM_GET_PROC(handle, "plugin_shutdown");
 
         if (!getInfo || !init || !shutdown) {
-            std::cerr << "Plugin missing required exports: " << name << std::endl;
-            PLATFORM_FREE_LIB(handle);
-            return false;
-        }
-
-        const PluginInfo* info = getInfo();
-        std::cout << "Loaded plugin: " << info->name
-                  << " v" << info->version << std::endl;
-
-        if (!init(&host)) {
-            std::cerr << "Plugin failed to initialize: " << name << std::endl;
-            PLATFORM_FREE_LIB(handle);
+            log_error("Plugin missing required exports: " + name);
+            close_library();
             return false;
         }
-
         return true;
     }
 
-    void unload() {
-        if (handle) {
-            shutdown();
-            PLATFORM_FREE_LIB(handle);
-            std::cout << "Unloaded plugin: " << name << std::endl;
-        }
+    void close_library() {
+        if (handle) PLATFORM_FREE_LIB(handle);
+        handle = nullptr;
     }
 
     // Host callbacks
@@ -217,7 +1079,7 @@ public:
     }
 
     static bool __cdecl host_set_data(const char* key, const char* value) {
-        return STORAGE.set(key, value);
+        return STORAGE.set(current_storage(), key, value);
     }
 
     static const char* __cdecl host_get_data(const char* key) {
@@ -240,116 +1102,829 @@ public:
         return TIMER_MANAGER.cancel_timer(timer_id);
     }
 
-    inline static std::vector<Plugin>* g_plugins = nullptr;
+    static void __cdecl host_send_events(const HostEvent* events, uint32_t count) {
+        for (uint32_t i = 0; i < count; i++) {
+            EVENT_BUS.send_event(events[i].name, events[i].payload);
+        }
+    }
+
+    static uint32_t __cdecl host_set_data_many(const HostKeyValue* items, uint32_t count) {
+        uint32_t stored = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            if (items[i].key && items[i].value && STORAGE.set(current_storage(), items[i].key, items[i].value)) stored++;
+        }
+        return stored;
+    }
+
+    static uint32_t __cdecl host_get_data_many(HostKeyValue* items, uint32_t count) {
+        uint32_t found = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            items[i].value = items[i].key ? STORAGE.get(items[i].key) : nullptr;
+            if (items[i].value) found++;
+        }
+        return found;
+    }
+
+    static void __cdecl host_register_events(const HostHandler* handlers, uint32_t count) {
+        for (uint32_t i = 0; i < count; i++) {
+            EVENT_BUS.register_event(handlers[i].eventName, handlers[i].callback);
+        }
+    }
+
+    static bool __cdecl host_register_typed(const char* eventName, uint64_t layoutHash, uint32_t size,
+                                            typed_callback_t cb) {
+        if (!eventName || !cb) return false;
+        return EVENT_BUS.register_typed(eventName, layoutHash, size, cb);
+    }
+
+    static void __cdecl host_unregister_typed(typed_callback_t cb) {
+        EVENT_BUS.unregister_typed(cb);
+    }
+
+    static void __cdecl host_send_typed(const char* eventName, uint64_t layoutHash, const void* data, uint32_t size) {
+        if (!eventName || (!data && size > 0)) return;
+        EVENT_BUS.send_typed(eventName, layoutHash, data, size);
+    }
+
+    static bool __cdecl host_set_value(const char* key, const DataValue* value) {
+        if (!key || !value) return false;
+        return STORAGE.set_value(current_storage(), key, *value);
+    }
+
+    static bool __cdecl host_get_value(const char* key, DataValue* out) {
+        if (!key || !out) return false;
+        return STORAGE.get_value(key, *out);
+    }
+
+    static bool __cdecl host_add_value(const char* key, const DataValue* delta, DataValue* result) {
+        if (!key || !delta) return false;
+        DataValue ignored;
+        return STORAGE.add(current_storage(), key, *delta, result ? *result : ignored);
+    }
+
+    static bool __cdecl host_compare_and_swap(const char* key, const DataValue* expected, const DataValue* desired) {
+        if (!key || !expected || !desired) return false;
+        return STORAGE.compare_and_swap(current_storage(), key, *expected, *desired);
+    }
+
+    static bool __cdecl host_exchange_value(const char* key, const DataValue* value, DataValue* previous) {
+        if (!key || !value) return false;
+        DataValue ignored;
+        return STORAGE.exchange(current_storage(), key, *value, previous ? *previous : ignored);
+    }
+
+    static bool __cdecl host_expire_data(const char* key, uint32_t ms) {
+        if (!key || !STORAGE.expire(key, ms)) return false;
+        // Owned by the host, the TTL outlives the plugin that set it
+        if (ms) TIMER_MANAGER.add_timer(ms, on_storage_expiry, false, nullptr);
+        return true;
+    }
+
+    static void* __cdecl host_alloc_memory(uint32_t size) {
+        return current_arena()->allocate(size);
+    }
+
+    static void __cdecl host_free_memory(void* ptr) {
+        PluginArena::free(ptr);
+    }
+
+    static void* __cdecl host_alloc_frame(uint32_t size) {
+        return current_arena()->allocate_frame(size);
+    }
+
+    static uint64_t __cdecl host_clock_ms() {
+        return CLOCK.now_ms();
+    }
+
+    static bool __cdecl host_set_event_policy(const char* eventName, uint32_t policy, uint32_t windowMs) {
+        if (!eventName) return false;
+        return EVENT_BUS.set_policy(eventName, policy, windowMs);
+    }
+
+    static bool __cdecl host_set_metric(const char* name, uint32_t type, double value) {
+        return PLUGIN_METRICS.set(CURRENT_PLUGIN ? CURRENT_PLUGIN->name : "", name, type, value);
+    }
+
+    static uint64_t __cdecl host_subscribe(const char* eventName, event_handler_t handler, void* userdata) {
+        if (!eventName || !handler) return 0;
+        return EVENT_BUS.subscribe(eventName, handler, userdata);
+    }
+
+    static bool __cdecl host_unsubscribe(uint64_t handle) {
+        return EVENT_BUS.unsubscribe(handle);
+    }
+
+    static uint64_t __cdecl host_schedule(uint32_t ms, event_handler_t handler, void* userdata, bool repeat) {
+        if (!handler) return 0;
+        return TIMER_MANAGER.add_timer(ms, nullptr, repeat, CURRENT_PLUGIN, handler, userdata);
+    }
+
+    static uint64_t __cdecl host_watch_data(const char* keyOrPrefix, event_callback_t cb) {
+        if (!keyOrPrefix || !cb) return 0;
+        return DATA_WATCHERS.watch(keyOrPrefix, cb);
+    }
+
+    static bool __cdecl host_unwatch_data(uint64_t watchId) {
+        return DATA_WATCHERS.unwatch(watchId);
+    }
+
+    static bool __cdecl host_load_plugin(const char* name);
+    static bool __cdecl host_unload_plugin(const char* name);
+};
+
+// Host pointers, one shared table so moving a Plugin never invalidates the
+// pointer handed to init(). Const and constant-initialized so statically
+// linked plugins, which call through it by name, can have it folded away
+extern const PluginHost PLUGIN_HOST_TABLE = {
+    Plugin::host_send_event,
+    Plugin::host_register_event,
+    Plugin::host_unregister_event,
+    Plugin::host_load_plugin,
+    Plugin::host_unload_plugin,
+    host_log,
+    Plugin::host_set_data,
+    Plugin::host_get_data,
+    Plugin::host_has_data,
+    Plugin::host_delete_data,
+    Plugin::host_set_timer,
+    Plugin::host_cancel_timer,
+
+    ABI_CURRENT,
+    sizeof(PluginHost),
+    HOST_FEATURE_BATCH | HOST_FEATURE_TYPED_EVENTS | HOST_FEATURE_WATCH | HOST_FEATURE_TYPED_DATA | HOST_FEATURE_MEMORY | HOST_FEATURE_CLOCK | HOST_FEATURE_EVENT_POLICY | HOST_FEATURE_METRICS |
+        HOST_FEATURE_USERDATA,
+
+    Plugin::host_send_events,
+    Plugin::host_set_data_many,
+    Plugin::host_get_data_many,
+    Plugin::host_register_events,
+
+    Plugin::host_register_typed,
+    Plugin::host_unregister_typed,
+    Plugin::host_send_typed,
+
+    Plugin::host_watch_data,
+    Plugin::host_unwatch_data,
+
+    Plugin::host_set_value,
+    Plugin::host_get_value,
+    Plugin::host_add_value,
+    Plugin::host_compare_and_swap,
+    Plugin::host_exchange_value,
+    Plugin::host_expire_data,
+
+    Plugin::host_alloc_memory,
+    Plugin::host_free_memory,
+    Plugin::host_alloc_frame,
+
+    Plugin::host_clock_ms,
+
+    Plugin::host_set_event_policy,
+
+    Plugin::host_set_metric,
+
+    Plugin::host_subscribe,
+    Plugin::host_unsubscribe,
+    Plugin::host_schedule
+};
+
+// ================= Registry =================
+
+// Slot and generation of a loaded plugin, 0 is never an id
+typedef uint64_t PluginId;
+
+// Loaded plugins in load order. Each Plugin has a slot of its own and never
+// moves, so loads from inside a callback leave the others where they are;
+// names map to slots for O(1) lookup. An id kept past its plugin's unload
+// stops resolving instead of naming whatever reuses the slot. Main thread
+class PluginRegistry {
+public:
+    // Takes a plugin that loaded, it goes last in load order
+    PluginId add(std::unique_ptr<Plugin> plugin) {
+        uint32_t index;
+        if (!freeSlots.empty()) {
+            index = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            index = (uint32_t)slots.size();
+            slots.emplace_back();
+        }
+
+        Slot& slot = slots[index];
+        byName[plugin->name] = index;
+        slot.plugin = std::move(plugin);
+        slot.pendingUnload = false;
+        slot.prev = tail;
+        slot.next = NONE;
+        if (tail != NONE) slots[tail].next = index;
+        else head = index;
+        tail = index;
+        count++;
+        return id_of(index);
+    }
+
+    Plugin* find(const std::string& name) const {
+        auto it = byName.find(name);
+        return it == byName.end() ? nullptr : slots[it->second].plugin.get();
+    }
+
+    Plugin* get(PluginId id) const {
+        uint32_t index = (uint32_t)id - 1;
+        if (index >= slots.size() || slots[index].generation != (uint32_t)(id >> 32)) return nullptr;
+        return slots[index].plugin.get();
+    }
+
+    size_t size() const { return count; }
+
+    // In load order, ids stay safe to use while unloading some of them
+    std::vector<PluginId> ids() const {
+        std::vector<PluginId> result;
+        result.reserve(count);
+        for (uint32_t i = head; i != NONE; i = slots[i].next) result.push_back(id_of(i));
+        return result;
+    }
+
+    // A plugin with a callback on the stack keeps its library until the
+    // callback returns, collect() unloads it at the next frame
+    bool unload(const std::string& name) {
+        auto it = byName.find(name);
+        return it != byName.end() && unload_slot(it->second);
+    }
 
-    static bool __cdecl host_load_plugin(const char* name) {
-        std::cout << "[Host] Plugin requested load: " << name << std::endl;
+    bool unload(PluginId id) {
+        return get(id) && unload_slot((uint32_t)id - 1);
+    }
 
-        Plugin p(name);
-        if (p.load()) {
-            g_plugins->push_back(std::move(p));
+    void collect() {
+        if (pending.empty()) return;
+        std::vector<PluginId> due;
+        due.swap(pending);
+        for (PluginId id : due) unload(id);
+    }
+
+    // Dependents were loaded after their dependencies. Shutdowns may unload
+    // others, so this always takes whatever is last now
+    void unload_all() {
+        pending.clear();
+        while (tail != NONE) release(tail)->unload();
+    }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Slot {
+        std::unique_ptr<Plugin> plugin; // Null while free
+        uint32_t generation = 0;
+        uint32_t prev = NONE, next = NONE; // Load order
+        bool pendingUnload = false;
+    };
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+    std::unordered_map<std::string, uint32_t> byName;
+    std::vector<PluginId> pending;
+    uint32_t head = NONE, tail = NONE;
+    size_t count = 0;
+
+    PluginId id_of(uint32_t index) const { return ((uint64_t)slots[index].generation << 32) | (index + 1); }
+
+    bool unload_slot(uint32_t index) {
+        Slot& slot = slots[index];
+        if (slot.plugin->context->active > 0) {
+            if (!slot.pendingUnload) {
+                slot.pendingUnload = true;
+                pending.push_back(id_of(index));
+                log_info("[Runtime] Unloading " + slot.plugin->name + " once its callbacks return");
+            }
             return true;
         }
+        release(index)->unload();
+        return true;
+    }
+
+    // Out of the registry before its shutdown runs, which may load or unload others
+    std::unique_ptr<Plugin> release(uint32_t index) {
+        Slot& slot = slots[index];
+        std::unique_ptr<Plugin> plugin = std::move(slot.plugin);
+        if (slot.prev != NONE) slots[slot.prev].next = slot.next;
+        else head = slot.next;
+        if (slot.next != NONE) slots[slot.next].prev = slot.prev;
+        else tail = slot.prev;
+        slot.prev = slot.next = NONE;
+        slot.pendingUnload = false;
+        slot.generation++;
+        freeSlots.push_back(index);
+        byName.erase(plugin->name);
+        count--;
+        return plugin;
+    }
+};
+
+PluginRegistry PLUGIN_REGISTRY;
+
+bool __cdecl Plugin::host_load_plugin(const char* name) {
+    log_info(std::string("[Host] Plugin requested load: ") + name);
+    if (PLUGIN_REGISTRY.find(name)) return true;
+
+    auto plugin = std::make_unique<Plugin>(name);
+    if (!plugin->load()) return false;
+    PLUGIN_REGISTRY.add(std::move(plugin));
+    return true;
+}
+
+bool __cdecl Plugin::host_unload_plugin(const char* name) {
+    log_info(std::string("[Host] Plugin requested unload: ") + name);
+    return PLUGIN_REGISTRY.unload(name);
+}
+
+static bool is_loaded(const std::string& name) {
+    return PLUGIN_REGISTRY.find(name) != nullptr;
+}
+
+// Dependencies name a plugin file or a capability some plugin declares
+static std::string resolve_dependency(const std::string& name) {
+    if (PLUGIN_INDEX.find(name)) return name;
+    const IndexedPlugin* provider = PLUGIN_INDEX.provider(name);
+    return provider ? provider->file : name;
+}
+
+// Loads the required dependencies the index knows about first, then the plugin.
+// Files this loaded go to loaded, in load order
+static bool load_with_dependencies(const std::string& file, std::vector<std::string>& chain, std::vector<std::string>& loaded) {
+    if (is_loaded(file)) return true;
+
+    if (std::find(chain.begin(), chain.end(), file) != chain.end()) {
+        log_error("[Runtime] Dependency cycle through: " + file);
         return false;
     }
 
-    static bool __cdecl host_unload_plugin(const char* name) {
-        std::cout << "[Host] Plugin requested unload: " << name << std::endl;
+    const IndexedPlugin* indexed = PLUGIN_INDEX.find(file);
+    if (indexed && !indexed->valid) {
+        log_error("[Runtime] Not a valid plugin: " + file);
+        return false;
+    }
 
-        for (size_t i = 0; i < g_plugins->size(); i++) {
-            if ((*g_plugins)[i].name == name) {
-                (*g_plugins)[i].unload();
-                g_plugins->erase(g_plugins->begin() + i);
-                return true;
+    if (indexed) {
+        // Copied, loading below can update the index entry
+        std::vector<IndexedDependency> deps = indexed->dependencies;
+
+        chain.push_back(file);
+        for (const auto& dep : deps) {
+            if (dep.type != DEP_TYPE_REQUIRED) continue;
+
+            std::string depFile = resolve_dependency(dep.name);
+            if (!PLUGIN_INDEX.find(depFile)) {
+                log_error("[Runtime] Missing dependency " + dep.name + " required by " + file);
+                chain.pop_back();
+                return false;
+            }
+            if (!load_with_dependencies(depFile, chain, loaded)) {
+                log_error("[Runtime] Failed to load dependency: " + dep.name);
+                chain.pop_back();
+                return false;
             }
         }
-        return false;
+        chain.pop_back();
     }
 
-    // Host pointers
-    PluginHost host = {
-        host_send_event,
-        host_register_event,
-        host_unregister_event,
-        host_load_plugin,
-        host_unload_plugin,
-        host_log,
-        host_set_data,
-        host_get_data,
-        host_has_data,
-        host_delete_data,
-        host_set_timer,
-        host_cancel_timer
-    };
-};
+    auto plugin = std::make_unique<Plugin>(file);
+    if (!plugin->load()) return false;
+    PLUGIN_REGISTRY.add(std::move(plugin));
+    loaded.push_back(file);
+
+    // First load of a plugin that declares dependencies in plugin_init
+    indexed = PLUGIN_INDEX.find(file);
+    std::vector<IndexedDependency> lateDeps;
+    if (indexed) lateDeps = indexed->dependencies;
 
-int main() {
-    std::cout << "[Runtime] Starting plugin host (" << WINLIN("Windows", "Linux") << ")..." << std::endl;
+    for (const auto& dep : lateDeps) {
+        if (dep.type != DEP_TYPE_REQUIRED) continue;
+        std::string depFile = resolve_dependency(dep.name);
+        if (is_loaded(depFile)) continue;
 
-    std::vector<Plugin> loadedPlugins;
-    Plugin::g_plugins = &loadedPlugins;
-    std::vector<std::string> pluginEntries = parse_ini("plugins.ini", "PLUGINS");
+        log_info("[Runtime] Checking dependency: " + dep.name);
 
-    if (pluginEntries.empty()) {
-        std::cerr << "[Runtime] No plugins found in plugins.ini" << std::endl;
+        if (!load_with_dependencies(depFile, chain, loaded)) {
+            log_error("[Runtime] Failed to load dependency: " + dep.name);
+        }
     }
+    return true;
+}
 
-    // Load plugins
-    for (const auto& entry : pluginEntries) {
-        size_t eq_pos = entry.find('=');
-        if (eq_pos == std::string::npos) {
-            std::cerr << "[Runtime] Invalid INI entry: " << entry << std::endl;
-            continue;
+// [PLUGINS] as last applied. The file is polled between frames, parsed again
+// only when its size or mtime changed and the result diffed against the
+// loaded set, so an unchanged deployment costs one stat every poll.
+class PluginConfig {
+public:
+    std::string path = "plugins.ini";
+    std::vector<std::string> files;          // Plugin files in [PLUGINS] order
+    std::unordered_set<std::string> managed; // Loaded for the config, entries and their dependencies
+
+    // Initial load, in file order
+    void load() {
+        stamp = file_stamp(path);
+        files = read();
+        if (files.empty()) {
+            log_error("[Runtime] No plugins found in plugins.ini");
+        }
+        for (const auto& file : files) add(file);
+    }
+
+    void poll() {
+        auto now = std::chrono::steady_clock::now();
+        if (now < nextPoll) return;
+        nextPoll = now + std::chrono::milliseconds(500);
+
+        FileStamp current = file_stamp(path);
+        if (current == stamp) {
+            pending = false;
+            return;
+        }
+
+        // Wait one more poll so a file still being written is not applied half way
+        if (!pending || current != pendingStamp) {
+            pending = true;
+            pendingStamp = current;
+            return;
+        }
+        pending = false;
+        stamp = current;
+
+        if (!current.exists) {
+            log_warn("[Runtime] plugins.ini is gone, keeping the loaded plugins");
+            return;
         }
+        apply(read());
+    }
 
-        std::string pluginPath = entry.substr(eq_pos + 1);
-        std::cout << "[Runtime] Loading plugin: " << pluginPath << std::endl;
+    void apply(const std::vector<std::string>& next) {
+        if (next == files) return;
+        PLUGIN_INDEX.refresh(PLUGIN_DIR);
+
+        // Still needed: new entries, plugins loaded outside the config and what they require
+        std::vector<std::string> stack(next.begin(), next.end());
+        std::vector<PluginId> loaded = PLUGIN_REGISTRY.ids();
+        for (PluginId id : loaded) {
+            const std::string& name = PLUGIN_REGISTRY.get(id)->name;
+            if (!managed.count(name)) stack.push_back(name);
+        }
+        std::unordered_set<std::string> keep;
+        while (!stack.empty()) {
+            std::string file = stack.back();
+            stack.pop_back();
+            if (!keep.insert(file).second) continue;
 
-        Plugin plugin(pluginPath);
+            const IndexedPlugin* indexed = PLUGIN_INDEX.find(file);
+            if (!indexed) continue;
+            for (const auto& dep : indexed->dependencies) {
+                if (dep.type == DEP_TYPE_REQUIRED) stack.push_back(resolve_dependency(dep.name));
+            }
+        }
 
-        if (!plugin.load()) {
-            std::cerr << "[Runtime] Failed to load plugin: " << pluginPath << std::endl;
-            continue;
+        // Dependents were loaded after their dependencies
+        size_t removed = 0;
+        for (size_t i = loaded.size(); i-- > 0;) {
+            Plugin* plugin = PLUGIN_REGISTRY.get(loaded[i]); // Null if a shutdown already unloaded it
+            if (!plugin || !managed.count(plugin->name) || keep.count(plugin->name)) continue;
+            managed.erase(plugin->name);
+            PLUGIN_REGISTRY.unload(loaded[i]);
+            removed++;
         }
 
-        const PluginInfo* info = plugin.getInfo();
+        size_t added = 0;
+        for (const auto& file : next) {
+            if (is_loaded(file)) continue;
+            if (add(file)) added++;
+        }
 
-        for (const auto& dep : info->dependencies) {
-            if (dep.type == DEP_TYPE_OPTIONAL) break;
-            if (!dep.name || dep.name[0] == '\0') break;
+        files = next;
+        if (PLUGIN_INDEX.dirty) PLUGIN_INDEX.save(PLUGIN_INDEX_FILE);
+        log_info("[Runtime] plugins.ini changed: " + std::to_string(added) + " loaded, " +
+                 std::to_string(removed) + " unloaded");
+    }
 
-            std::cout << "[Runtime] Checking dependency: " << dep.name << std::endl;
+private:
+    FileStamp stamp;
+    FileStamp pendingStamp;
+    bool pending = false;
+    std::chrono::steady_clock::time_point nextPoll;
 
-            Plugin depPlugin(dep.name);
-            if (!depPlugin.load()) {
-                std::cerr << "[Runtime] Failed to load dependency: " << dep.name << std::endl;
+    std::vector<std::string> read() const {
+        std::vector<std::string> result;
+        for (const auto& entry : parse_ini(path, "PLUGINS")) {
+            size_t eq_pos = entry.find('=');
+            if (eq_pos == std::string::npos) {
+                log_error("[Runtime] Invalid INI entry: " + entry);
                 continue;
             }
+            result.push_back(entry.substr(eq_pos + 1));
+        }
+        return result;
+    }
+
+    bool add(const std::string& file) {
+        log_info("[Runtime] Loading plugin: " + file);
+
+        std::vector<std::string> chain, loaded;
+        bool ok = load_with_dependencies(file, chain, loaded);
+        if (!ok) log_error("[Runtime] Failed to load plugin: " + file);
+
+        managed.insert(loaded.begin(), loaded.end());
+        return ok;
+    }
+};
+
+PluginConfig PLUGIN_CONFIG;
+
+// Answers the console's list command from the index, no plugin is opened
+static void on_request_plugin_list(const char* eventName, const char* payload) {
+    PLUGIN_INDEX.refresh(PLUGIN_DIR);
+
+    std::string list;
+    for (const IndexedPlugin* e : PLUGIN_INDEX.sorted()) {
+        list += e->file;
+        if (e->valid) list += " (" + e->name + " v" + e->version + ")";
+        else list += " (invalid)";
+        if (is_loaded(e->file)) list += " [loaded]";
+        if (e->valid) list += " abi v" + std::to_string(e->abi_version);
+        if (e->linked) list += " static";
+
+        for (size_t i = 0; i < e->capabilities.size(); i++) {
+            list += i == 0 ? " provides: " : ", ";
+            list += e->capabilities[i];
+        }
+
+        for (size_t i = 0; i < e->dependencies.size(); i++) {
+            list += i == 0 ? " deps: " : ", ";
+            list += e->dependencies[i].name;
+            if (e->dependencies[i].type == DEP_TYPE_OPTIONAL) list += "?";
+        }
+        list += "\n";
+    }
+    EVENT_BUS.send_event("pluginList", list.c_str());
+}
+
+// One line per plugin partition, for the console's storage command
+static void on_request_storage_usage(const char* eventName, const char* payload) {
+    EVENT_BUS.send_event("storageUsage", STORAGE.usage().c_str());
+}
+
+// One line per plugin with timing totals, for the console's budget command
+static void on_request_budget_report(const char* eventName, const char* payload) {
+    std::string report = BUDGETS.enabled ? BUDGETS.report() : "Budgets are off, add a [BUDGETS] section to plugins.ini\n";
+    if (BUDGETS.enabled && (!EVENT_BUS.deferred.empty() || EVENT_BUS.deferredDropped)) {
+        report += "deferred events " + std::to_string(EVENT_BUS.deferred.size()) +
+                  " dropped " + std::to_string(EVENT_BUS.deferredDropped) + "\n";
+    }
+    EVENT_BUS.send_event("budgetReport", report.c_str());
+}
+
+// One line per plugin arena, for the console's memory command
+static void on_request_memory_usage(const char* eventName, const char* payload) {
+    EVENT_BUS.send_event("memoryUsage", MEMORY.usage().c_str());
+}
+
+// One line per event name with a delivery policy, for the console's events command
+static void on_request_event_policies(const char* eventName, const char* payload) {
+    std::string report = EVENT_BUS.coalesced.empty() ? "No event has a delivery policy, see [EVENTS] in plugins.ini\n"
+                                                      : EVENT_BUS.policy_report();
+    EVENT_BUS.send_event("eventPolicies", report.c_str());
+}
+
+// Payload: "<plugin|*> <level>", sent by the console's loglevel command
+static void on_set_log_level(const char* eventName, const char* payload) {
+    std::string args = payload ? payload : "";
+    size_t space = args.find(' ');
+    if (space == std::string::npos) {
+        log_warn("[Runtime] setLogLevel expects \"<plugin|*> <level>\"");
+        return;
+    }
+    std::string target = args.substr(0, space);
+    std::string level = args.substr(space + 1);
+    LOGGER.set_level(target, log_level_from_string(level.c_str()));
+    log_info("[Runtime] Log level for " + target + " set to " + level);
+}
+
+// ================= Metrics =================
+
+struct FrameStats {
+    uint64_t frames = 0;
+    uint64_t workNs = 0;      // Last frame, without the sleep
+    uint64_t totalWorkNs = 0;
+    std::vector<uint64_t> history; // Every frame's work, kept with --stats for percentiles
+};
+
+// --stats summary, one line per phase so tools/scale_harness can parse it
+static void log_frame_stats(FrameStats& frame) {
+    std::vector<uint64_t>& work = frame.history;
+    if (work.empty()) return;
+    std::sort(work.begin(), work.end());
+    auto ms = [](uint64_t ns) { return std::to_string(ns / 1e6); };
+    log_info("[Stats] frames " + std::to_string(work.size()) + " mean_ms " + ms(frame.totalWorkNs / work.size()) +
+             " p99_ms " + ms(work[std::min(work.size() - 1, work.size() * 99 / 100)]) + " max_ms " + ms(work.back()));
+}
+
+// Everything the page shows, in a stable order so most publishes only store values
+static void publish_metrics(const FrameStats& frame) {
+    uint64_t now = budget_now_ns();
+    if (!METRICS.due(now)) return;
+
+    static std::vector<MetricSample> samples;
+    samples.clear();
+    auto add = [](const std::string& key, uint32_t type, double value) { samples.push_back({key, type, value}); };
+
+    add("runtime_frames_total", METRIC_COUNTER, (double)frame.frames);
+    add("runtime_frame_work_seconds", METRIC_GAUGE, frame.workNs / 1e9);
+    add("runtime_frame_work_seconds_total", METRIC_COUNTER, frame.totalWorkNs / 1e9);
+    add("runtime_plugins_loaded", METRIC_GAUGE, (double)PLUGIN_REGISTRY.size());
+
+    std::vector<const std::pair<const std::string, EventChannel>*> channels;
+    for (const auto& pair : EVENT_BUS.channels) channels.push_back(&pair);
+    std::sort(channels.begin(), channels.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+    for (const auto* channel : channels) {
+        add(metric_key("runtime_events_sent_total", "event", channel->first), METRIC_COUNTER, (double)channel->second.sent);
+    }
+    for (const auto* channel : channels) {
+        add(metric_key("runtime_event_listeners", "event", channel->first), METRIC_GAUGE, (double)channel->second.listeners.size());
+    }
+    for (const auto& pair : EVENT_BUS.coalesced) {
+        add(metric_key("runtime_events_collapsed_total", "event", pair.first), METRIC_COUNTER, (double)pair.second.collapsed);
+    }
+    for (const auto& pair : EVENT_BUS.coalesced) {
+        add(metric_key("runtime_events_held", "event", pair.first), METRIC_GAUGE, (double)pair.second.held.size());
+    }
+    add("runtime_events_undelivered_total", METRIC_COUNTER, (double)EVENT_BUS.undelivered);
+    add("runtime_typed_events_sent_total", METRIC_COUNTER, (double)EVENT_BUS.typedSent);
+    add("runtime_deferred_events", METRIC_GAUGE, (double)EVENT_BUS.deferred.size());
+    add("runtime_deferred_dropped_total", METRIC_COUNTER, (double)EVENT_BUS.deferredDropped);
+
+    add("runtime_timers", METRIC_GAUGE, (double)TIMER_MANAGER.timers.size());
+    add("runtime_timers_fired_total", METRIC_COUNTER, (double)TIMER_MANAGER.firedTotal);
+    add("runtime_storage_watches", METRIC_GAUGE, (double)DATA_WATCHERS.patterns.size());
+    add("runtime_log_dropped_total", METRIC_COUNTER, (double)LOGGER.dropped());
+
+    STORAGE.metrics(samples);
+    MEMORY.metrics(samples);
+    if (BUDGETS.enabled) BUDGETS.metrics(samples);
+    PLUGIN_METRICS.collect(samples);
+
+    METRICS.publish(samples, now);
+}
+
+int main(int argc, char** argv) {
+    LOGGER.configure(parse_ini("plugins.ini", "LOGGING"));
+    LOGGER.open();
+    STORAGE.configure(parse_ini("plugins.ini", "STORAGE"));
+    BUDGETS.configure(parse_ini("plugins.ini", "BUDGETS"));
+    BUDGETS.open();
+    METRICS.configure(parse_ini("plugins.ini", "METRICS"));
+    METRICS.open();
+    EVENT_BUS.register_event("setLogLevel", on_set_log_level);
+    EVENT_BUS.register_event("requestPluginList", on_request_plugin_list);
+    EVENT_BUS.register_event("requestStorageUsage", on_request_storage_usage);
+    EVENT_BUS.register_event("requestBudgetReport", on_request_budget_report);
+    EVENT_BUS.register_event("requestMemoryUsage", on_request_memory_usage);
+    EVENT_BUS.register_event("requestEventPolicies", on_request_event_policies);
+    EVENT_BUS.configure(parse_ini("plugins.ini", "EVENTS"));
+
+    log_info(std::string("[Runtime] Starting plugin host (") + WINLIN("Windows", "Linux") + ")...");
+
+    // --record <file>: write every dispatched event to a binary trace
+    // --replay <file>: re-inject a recorded trace at its original timing
+    // --fast: with --replay, inject as fast as possible and exit
+    // --virtual <ms|next>: simulated time, frames advance the clock by ms or to the next deadline without sleeping
+    // --until <duration>: exit once the clock has moved this far in the main loop, e.g. 24h
+    // --stats: log startup, per-frame work and unload times at exit
+    const char* recordPath = nullptr;
+    const char* replayPath = nullptr;
+    bool replayFast = false;
+    bool stats = false;
+    Clock::duration until = Clock::duration::zero();
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--record" && i + 1 < argc) recordPath = argv[++i];
+        else if (arg == "--replay" && i + 1 < argc) replayPath = argv[++i];
+        else if (arg == "--fast") replayFast = true;
+        else if (arg == "--stats") stats = true;
+        else if (arg == "--virtual" && i + 1 < argc) {
+            if (!CLOCK.set_virtual(argv[++i])) log_warn(std::string("[Runtime] --virtual expects a step in ms or \"next\", got ") + argv[i]);
+        }
+        else if (arg == "--until" && i + 1 < argc) {
+            if (!parse_duration(argv[++i], until)) log_warn(std::string("[Runtime] --until expects a duration such as 90s or 24h, got ") + argv[i]);
+        }
+        else log_warn("[Runtime] Unknown argument: " + arg);
+    }
+    if (CLOCK.is_virtual()) {
+        log_info(CLOCK.mode == Clock::VIRTUAL_NEXT ? std::string("[Runtime] Virtual clock, jumping to the next deadline")
+                 : "[Runtime] Virtual clock, " + std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(CLOCK.step).count()) + " ms per frame");
+    }
+
+    TraceRecorder recorder;
+    if (recordPath && recorder.open(recordPath)) {
+        ACTIVE_TRACE = &recorder;
+        log_info(std::string("[Runtime] Recording events to ") + recordPath);
+    }
 
-            loadedPlugins.push_back(std::move(depPlugin));
+    TraceReplayer replayer;
+    if (replayPath) {
+        if (!replayer.open(replayPath)) {
+            BUDGETS.close();
+            LOGGER.close();
+            return 1;
         }
+        log_info("[Runtime] Replaying " + std::to_string(replayer.events().size()) +
+                 " events from " + replayPath);
+    }
+
+    uint64_t startupNs = budget_now_ns();
+    PLUGIN_INDEX.load(PLUGIN_INDEX_FILE);
+    for (const auto& linked : static_plugins()) PLUGIN_INDEX.link(linked.file, linked.getInfo());
+    size_t probed = PLUGIN_INDEX.refresh(PLUGIN_DIR);
+    log_info("[Runtime] Plugin index: " + std::to_string(PLUGIN_INDEX.sorted().size()) +
+             " plugins, " + std::to_string(probed) + " probed");
+
+    // Load plugins
+    PLUGIN_CONFIG.load();
 
-        loadedPlugins.push_back(std::move(plugin));
+    if (PLUGIN_INDEX.dirty) PLUGIN_INDEX.save(PLUGIN_INDEX_FILE);
+    if (stats) {
+        log_info("[Stats] plugins " + std::to_string(PLUGIN_REGISTRY.size()) + " startup_ms " +
+                 std::to_string((budget_now_ns() - startupNs) / 1e6) + " probed " + std::to_string(probed));
     }
 
-    std::cout << "[Runtime] Entering main loop (Press ESC to quit)..." << std::endl;
+    auto inject = [](const char* eventName, const char* payload) {
+        EVENT_BUS.send_event(eventName, payload);
+    };
+
+    if (replayPath && replayFast) {
+        auto begin = std::chrono::steady_clock::now();
+        size_t sent = replayer.replay_fast(inject);
+        EVENT_BUS.flush_coalesced();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        log_info("[Runtime] Replayed " + std::to_string(sent) + " events in " +
+                 std::to_string(seconds * 1000.0) + " ms (" +
+                 std::to_string(seconds > 0 ? (uint64_t)(sent / seconds) : 0) + " events/s)");
+
+        PLUGIN_REGISTRY.unload_all();
+        if (PLUGIN_INDEX.dirty) PLUGIN_INDEX.save(PLUGIN_INDEX_FILE);
+        BUDGETS.close();
+        LOGGER.close();
+        return 0;
+    }
+    if (replayPath) replayer.begin();
+
+    log_info("[Runtime] Entering main loop (Press ESC to quit)...");
     std::cout << "> ";
     std::cout.flush(); // Ensure prompt is visible
 
     bool running = true;
     std::string inputBuffer;
+    FrameStats frame;
+    auto realStart = std::chrono::steady_clock::now();
+    Clock::time_point lastFrame = CLOCK.now();
+    Clock::time_point loopStart = lastFrame; // --until counts from here, loading can take a while
 
     while (running) {
+        uint64_t frameStart = METRICS.enabled() || stats ? budget_now_ns() : 0;
+
+        PLUGIN_REGISTRY.collect();
+        // A replay runs against the plugin set it was recorded with
+        if (!replayPath) PLUGIN_CONFIG.poll();
+        MEMORY.next_frame();
+        BUDGETS.review();
+        EVENT_BUS.run_deferred();
         TIMER_MANAGER.update();
         
-        EVENT_BUS.send_event("tick", "16ms");
+        if (replayPath) {
+            // The trace carries the recorded ticks
+            replayer.replay_due(inject);
+            if (replayer.finished()) {
+                log_info("\n[Runtime] Replay finished, shutting down...");
+                running = false;
+            }
+        } else if (CLOCK.is_virtual()) {
+            // Simulated frames can be any length, tick carries the one that just passed
+            Clock::time_point at = CLOCK.now();
+            std::string elapsed = std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(at - lastFrame).count()) + "ms";
+            lastFrame = at;
+            EVENT_BUS.send_event("tick", elapsed.c_str());
+        } else {
+            EVENT_BUS.send_event("tick", "16ms");
+        }
+
+        // Surviving latest, keyed, debounced and throttled events
+        EVENT_BUS.flush_coalesced();
+
+        // Everything written this frame, one callback per key
+        DATA_WATCHERS.flush();
 
         // Cross-platform input handling from ABI layer
         if (platform_kbhit()) {
             int ch = platform_getch();
 
             if (ch == 27) { // ESC
-                 std::cout << "\n[Runtime] ESC pressed, shutting down..." << std::endl;
+                 log_info("\n[Runtime] ESC pressed, shutting down...");
                  running = false;
             }
             else if (ch == '\r' || ch == '\n') { // Enter
@@ -375,13 +1950,65 @@ int main() {
             }
         }
 
-        PLATFORM_SLEEP_MS(16);
+        frame.frames++;
+        if (METRICS.enabled() || stats) {
+            frame.workNs = budget_now_ns() - frameStart;
+            frame.totalWorkNs += frame.workNs;
+            if (stats) frame.history.push_back(frame.workNs);
+            if (METRICS.enabled()) publish_metrics(frame);
+        }
+
+        if (until > Clock::duration::zero() && CLOCK.now() - loopStart >= until) {
+            log_info("\n[Runtime] Reached --until " + format_duration(until) + ", shutting down...");
+            running = false;
+        }
+
+        // Sleeps in real time, otherwise moves the virtual clock to the next frame
+        Clock::time_point deadline;
+        bool hasDeadline = false;
+        if (CLOCK.mode == Clock::VIRTUAL_NEXT) {
+            auto earliest = [&](Clock::time_point at) {
+                if (hasDeadline && at >= deadline) return;
+                deadline = at;
+                hasDeadline = true;
+            };
+            Clock::time_point at;
+            if (TIMER_MANAGER.next_deadline(at)) earliest(at);
+            if (EVENT_BUS.next_deadline(at)) earliest(at);
+            if (replayPath && replayer.next_due(at)) earliest(at);
+        }
+        if (running) CLOCK.next_frame(hasDeadline ? &deadline : nullptr);
+    }
+
+    if (CLOCK.is_virtual()) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - realStart).count();
+        double simulated = std::chrono::duration<double>(CLOCK.elapsed()).count();
+        log_info("[Runtime] Simulated " + format_duration(CLOCK.elapsed()) + " in " + std::to_string(seconds) + " s (" +
+                 std::to_string(seconds > 0 ? (uint64_t)(simulated / seconds) : 0) + "x), " + std::to_string(frame.frames) +
+                 " frames, " + std::to_string(TIMER_MANAGER.firedTotal) + " timers fired");
     }
 
-    for (auto& plugin : loadedPlugins) {
-        plugin.unload();
+    if (stats) log_frame_stats(frame);
+
+    uint64_t unloadNs = budget_now_ns();
+    size_t unloading = PLUGIN_REGISTRY.size();
+    PLUGIN_REGISTRY.unload_all();
+    if (stats) {
+        log_info("[Stats] unloaded " + std::to_string(unloading) + " unload_ms " +
+                 std::to_string((budget_now_ns() - unloadNs) / 1e6));
+    }
+
+    if (PLUGIN_INDEX.dirty) PLUGIN_INDEX.save(PLUGIN_INDEX_FILE);
+
+    if (ACTIVE_TRACE) {
+        ACTIVE_TRACE = nullptr;
+        recorder.close();
+        log_info("[Runtime] Recorded " + std::to_string(recorder.recorded()) + " events");
     }
 
-    std::cout << "[Runtime] Exiting." << std::endl;
+    METRICS.close();
+    BUDGETS.close();
+    log_info("[Runtime] Exiting.");
+    LOGGER.close();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,420 @@
+#include "storage.h"
+#include "clock.h"
+#include "log.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+uint64_t parse_size(const std::string& text) {
+    size_t end = 0;
+    uint64_t value = 0;
+    try {
+        value = std::stoull(text, &end);
+    } catch (...) {
+        return 0;
+    }
+    if (end < text.size()) {
+        char unit = (char)toupper((unsigned char)text[end]);
+        if (unit == 'K') value <<= 10;
+        else if (unit == 'M') value <<= 20;
+        else if (unit == 'G') value <<= 30;
+    }
+    return value;
+}
+
+// ================= Partition =================
+
+static int size_class(uint32_t size) {
+    for (int c = 0; c < STORAGE_SLAB_CLASSES; c++) {
+        if (size <= (uint32_t)STORAGE_SLAB_MIN << c) return c;
+    }
+    return -1;
+}
+
+bool StoragePartition::same_class(uint32_t a, uint32_t b) {
+    int c = size_class(a);
+    return c >= 0 && c == size_class(b);
+}
+
+char* StoragePartition::allocate(uint32_t size) {
+    int c = size_class(size);
+    if (c < 0) {
+        // Too big for a slab, gets its own allocation on the partition's list
+        char* raw = new char[sizeof(LargeValue) + size];
+        LargeValue* node = reinterpret_cast<LargeValue*>(raw);
+        node->prev = nullptr;
+        node->next = large;
+        if (large) large->prev = node;
+        large = node;
+        reserved += size;
+        return raw + sizeof(LargeValue);
+    }
+
+    if (freeLists[c]) {
+        FreeNode* node = freeLists[c];
+        freeLists[c] = node->next;
+        return reinterpret_cast<char*>(node);
+    }
+
+    uint32_t slab = (uint32_t)STORAGE_SLAB_MIN << c;
+    if (!cursor || cursor + slab > end) {
+        char* block = new char[STORAGE_BLOCK_SIZE];
+        blocks.push_back(block);
+        reserved += STORAGE_BLOCK_SIZE;
+        cursor = block;
+        end = block + STORAGE_BLOCK_SIZE;
+    }
+    char* ptr = cursor;
+    cursor += slab;
+    return ptr;
+}
+
+void StoragePartition::free(char* ptr, uint32_t size) {
+    int c = size_class(size);
+    if (c < 0) {
+        LargeValue* node = reinterpret_cast<LargeValue*>(ptr - sizeof(LargeValue));
+        if (node->prev) node->prev->next = node->next;
+        else large = node->next;
+        if (node->next) node->next->prev = node->prev;
+        reserved -= size;
+        delete[] reinterpret_cast<char*>(node);
+        return;
+    }
+
+    FreeNode* node = reinterpret_cast<FreeNode*>(ptr);
+    node->next = freeLists[c];
+    freeLists[c] = node;
+}
+
+void StoragePartition::release() {
+    for (char* block : blocks) delete[] block;
+    blocks.clear();
+    while (large) {
+        LargeValue* next = large->next;
+        delete[] reinterpret_cast<char*>(large);
+        large = next;
+    }
+    cursor = end = nullptr;
+    std::fill(std::begin(freeLists), std::end(freeLists), nullptr);
+
+    bytes = keys = reserved = 0;
+    generation++;
+}
+
+// ================= Storage =================
+
+void Storage::configure(const std::vector<std::string>& entries) {
+    for (const auto& entry : entries) {
+        size_t eq_pos = entry.find('=');
+        if (eq_pos == std::string::npos) continue;
+
+        std::string key = entry.substr(0, eq_pos);
+        uint64_t value = parse_size(entry.substr(eq_pos + 1));
+
+        if (key == "bytes") defaults.maxBytes = value;
+        else if (key == "keys") defaults.maxKeys = value;
+        else if (key.size() > 5 && key.compare(key.size() - 5, 5, ".keys") == 0) keyQuotas[key.substr(0, key.size() - 5)] = value;
+        else byteQuotas[key] = value;
+    }
+}
+
+StoragePartition* Storage::partition(const std::string& name) {
+    auto it = partitions.find(name);
+    if (it != partitions.end()) return it->second.get();
+
+    auto part = std::make_unique<StoragePartition>();
+    part->name = name;
+    if (!name.empty()) {
+        // The host's own keys are never limited
+        auto bytes = byteQuotas.find(name);
+        auto keys = keyQuotas.find(name);
+        part->quota.maxBytes = bytes != byteQuotas.end() ? bytes->second : defaults.maxBytes;
+        part->quota.maxKeys = keys != keyQuotas.end() ? keys->second : defaults.maxKeys;
+    }
+    return partitions.emplace(name, std::move(part)).first->second.get();
+}
+
+Storage::Slot* Storage::find(const char* key) {
+    auto it = index.find(key);
+    if (it == index.end()) return nullptr;
+
+    // Owner was released since this key was written
+    if (it->second.generation != it->second.owner->generation) {
+        index.erase(it);
+        stale--;
+        return nullptr;
+    }
+    return &it->second;
+}
+
+void Storage::sweep() {
+    for (auto it = index.begin(); it != index.end();) {
+        if (it->second.generation != it->second.owner->generation) it = index.erase(it);
+        else ++it;
+    }
+    stale = 0;
+}
+
+static bool is_number(uint32_t type) { return type == DATA_INT64 || type == DATA_DOUBLE; }
+static bool is_buffer(uint32_t type) { return type == DATA_STRING || type == DATA_BYTES; }
+
+uint32_t Storage::value_capacity(const Slot& slot) {
+    return is_number(slot.type) ? STORAGE_NUMBER_TEXT : slot.size + 1;
+}
+
+void Storage::format_number(Slot& slot) {
+    if (slot.type == DATA_INT64) snprintf(slot.value, STORAGE_NUMBER_TEXT, "%lld", (long long)slot.number.i);
+    else snprintf(slot.value, STORAGE_NUMBER_TEXT, "%.17g", slot.number.d);
+}
+
+bool Storage::write(StoragePartition* owner, const char* key, const DataValue& value, bool keepExpiry) {
+    if (!owner) owner = partition("");
+    if (!is_number(value.type) && !is_buffer(value.type)) return false;
+    if (is_buffer(value.type) && !value.data && value.size > 0) return false;
+
+    uint32_t keyLen = (uint32_t)strlen(key);
+    uint32_t size = is_number(value.type) ? 8 : value.size;
+
+    Slot* slot = find(key);
+    bool sameOwner = slot && slot->owner == owner;
+
+    uint64_t newBytes = owner->bytes + size + (sameOwner ? 0 : keyLen) - (sameOwner ? slot->size : 0);
+    uint64_t newKeys = owner->keys + (sameOwner ? 0 : 1);
+    if ((owner->quota.maxBytes && newBytes > owner->quota.maxBytes) ||
+        (owner->quota.maxKeys && newKeys > owner->quota.maxKeys)) {
+        if (owner->rejected++ == 0) {
+            log_warn("[Storage] " + owner->name + " is over its storage quota, rejecting writes (" +
+                     std::to_string(owner->bytes) + " bytes, " + std::to_string(owner->keys) + " keys)");
+        }
+        return false;
+    }
+
+    char* buffer = nullptr;
+    if (is_buffer(value.type)) {
+        bool reuse = sameOwner && is_buffer(slot->type) && StoragePartition::same_class(slot->size + 1, size + 1);
+        buffer = reuse ? slot->value : owner->allocate(size + 1);
+        memmove(buffer, value.data, size);
+        buffer[size] = '\0';
+        if (reuse) slot->value = nullptr;
+    }
+
+    uint64_t expiresAt = 0;
+    if (slot) {
+        // Rewritten by another plugin, the key moves to the writer's partition
+        if (slot->value) slot->owner->free(slot->value, value_capacity(*slot));
+        if (!sameOwner) {
+            slot->owner->bytes -= keyLen + slot->size;
+            slot->owner->keys--;
+        }
+        if (keepExpiry) expiresAt = slot->expiresAt;
+    } else {
+        if (stale > index.size() - stale) sweep();
+        slot = &index.emplace(key, Slot{}).first->second;
+    }
+
+    *slot = Slot{owner, owner->generation, value.type, buffer, size, {0}, expiresAt};
+    if (value.type == DATA_INT64) slot->number.i = value.i;
+    else if (value.type == DATA_DOUBLE) slot->number.d = value.d;
+
+    owner->bytes = newBytes;
+    owner->keys = newKeys;
+    changed(key);
+    return true;
+}
+
+bool Storage::set(StoragePartition* owner, const char* key, const char* value) {
+    DataValue v = {DATA_STRING, (uint32_t)strlen(value), 0, 0.0, value};
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    return write(owner, key, v, false);
+}
+
+bool Storage::set_value(StoragePartition* owner, const char* key, const DataValue& value) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    return write(owner, key, value, false);
+}
+
+const char* Storage::get(const char* key) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    Slot* slot = find(key);
+    if (!slot) return nullptr;
+    if (!is_number(slot->type) || slot->value) return slot->value;
+
+    // Not charged to the quota, the number itself already is
+    slot->value = slot->owner->allocate(STORAGE_NUMBER_TEXT);
+    format_number(*slot);
+    return slot->value;
+}
+
+bool Storage::get_value(const char* key, DataValue& out) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    out = DataValue{DATA_NONE, 0, 0, 0.0, nullptr};
+
+    Slot* slot = find(key);
+    if (!slot) return false;
+
+    out.type = slot->type;
+    if (slot->type == DATA_INT64) out.i = slot->number.i;
+    else if (slot->type == DATA_DOUBLE) out.d = slot->number.d;
+    else {
+        out.data = slot->value;
+        out.size = slot->size;
+    }
+    return true;
+}
+
+bool Storage::has(const char* key) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    return find(key) != nullptr;
+}
+
+bool Storage::erase(const char* key) {
+    Slot* slot = find(key);
+    if (!slot) return false;
+
+    StoragePartition* owner = slot->owner;
+    if (slot->value) owner->free(slot->value, value_capacity(*slot));
+    owner->bytes -= strlen(key) + slot->size;
+    owner->keys--;
+    index.erase(key);
+    changed(key);
+    return true;
+}
+
+bool Storage::remove(const char* key) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    return erase(key);
+}
+
+bool Storage::add(StoragePartition* owner, const char* key, const DataValue& delta, DataValue& result) {
+    if (!is_number(delta.type)) return false;
+    std::lock_guard<std::recursive_mutex> guard(lock);
+
+    Slot* slot = find(key);
+    if (!slot) {
+        result = delta;
+        return write(owner, key, delta, false);
+    }
+    if (slot->type != delta.type) return false;
+
+    result = delta;
+    if (delta.type == DATA_INT64) result.i = slot->number.i = (int64_t)((uint64_t)slot->number.i + (uint64_t)delta.i);
+    else result.d = slot->number.d += delta.d;
+    if (slot->value) format_number(*slot);
+    changed(key);
+    return true;
+}
+
+bool Storage::exchange(StoragePartition* owner, const char* key, const DataValue& value, DataValue& previous) {
+    if (!is_number(value.type)) return false;
+    std::lock_guard<std::recursive_mutex> guard(lock);
+
+    previous = DataValue{DATA_NONE, 0, 0, 0.0, nullptr};
+    Slot* slot = find(key);
+    if (slot) {
+        // A string or bytes value could not be handed back once replaced
+        if (!is_number(slot->type)) return false;
+        previous.type = slot->type;
+        previous.i = slot->type == DATA_INT64 ? slot->number.i : 0;
+        previous.d = slot->type == DATA_DOUBLE ? slot->number.d : 0.0;
+    }
+    return write(owner, key, value, true);
+}
+
+bool Storage::compare_and_swap(StoragePartition* owner, const char* key, const DataValue& expected, const DataValue& desired) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+
+    Slot* slot = find(key);
+    bool matches;
+    if (!slot) matches = expected.type == DATA_NONE;
+    else if (slot->type != expected.type) matches = false;
+    else if (slot->type == DATA_INT64) matches = slot->number.i == expected.i;
+    else if (slot->type == DATA_DOUBLE) matches = slot->number.d == expected.d;
+    else matches = slot->size == expected.size && (expected.size == 0 || memcmp(slot->value, expected.data, expected.size) == 0);
+    if (!matches) return false;
+
+    if (desired.type == DATA_NONE) return !slot || erase(key);
+    return write(owner, key, desired, true);
+}
+
+bool Storage::expire(const char* key, uint32_t ms) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    Slot* slot = find(key);
+    if (!slot) return false;
+
+    slot->expiresAt = ms ? CLOCK.now_ms() + ms : 0;
+    if (ms) expiries.push({slot->expiresAt, key});
+    return true;
+}
+
+size_t Storage::expire_due() {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    uint64_t now = CLOCK.now_ms();
+    size_t removed = 0;
+
+    while (!expiries.empty() && expiries.top().first <= now) {
+        Expiry entry = expiries.top();
+        expiries.pop();
+
+        // Entries for keys rewritten or given a new TTL since are skipped
+        Slot* slot = find(entry.second.c_str());
+        if (slot && slot->expiresAt == entry.first && erase(entry.second.c_str())) removed++;
+    }
+    return removed;
+}
+
+void Storage::release(StoragePartition* owner) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    if (!owner) return;
+    // Blocks go even when no key is left, deleting keys only refills the free lists
+    stale += owner->keys;
+    owner->release();
+}
+
+void Storage::changed(const char* key) {
+    if (trackChanges && changedKeys.insert(key).second) changes.emplace_back(key);
+}
+
+std::vector<std::string> Storage::take_changes() {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    std::vector<std::string> out;
+    out.swap(changes);
+    changedKeys.clear();
+    return out;
+}
+
+std::string Storage::usage() const {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    std::vector<const StoragePartition*> sorted;
+    for (const auto& pair : partitions) sorted.push_back(pair.second.get());
+    std::sort(sorted.begin(), sorted.end(),
+        [](const StoragePartition* a, const StoragePartition* b) { return a->name < b->name; });
+
+    auto limit = [](uint64_t v) { return v ? std::to_string(v) : std::string("-"); };
+
+    std::string out;
+    for (const StoragePartition* p : sorted) {
+        if (p->keys == 0 && p->rejected == 0) continue;
+        out += (p->name.empty() ? std::string("host") : p->name) +
+               " bytes " + std::to_string(p->bytes) + "/" + limit(p->quota.maxBytes) +
+               " keys " + std::to_string(p->keys) + "/" + limit(p->quota.maxKeys) +
+               " reserved " + std::to_string(p->reserved) +
+               " rejected " + std::to_string(p->rejected) + "\n";
+    }
+    return out;
+}
+
+void Storage::metrics(std::vector<MetricSample>& out) const {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    std::vector<const StoragePartition*> sorted;
+    for (const auto& pair : partitions) sorted.push_back(pair.second.get());
+    std::sort(sorted.begin(), sorted.end(),
+        [](const StoragePartition* a, const StoragePartition* b) { return a->name < b->name; });
+
+    for (const StoragePartition* p : sorted) {
+        std::string name = p->name.empty() ? "host" : p->name;
+        out.push_back({metric_key("runtime_storage_bytes", "plugin", name), METRIC_GAUGE, (double)p->bytes});
+        out.push_back({metric_key("runtime_storage_keys", "plugin", name), METRIC_GAUGE, (double)p->keys});
+        out.push_back({metric_key("runtime_storage_rejected_total", "plugin", name), METRIC_COUNTER, (double)p->rejected});
+    }
+}
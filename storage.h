@@ -0,0 +1,150 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "plugin_api.h"
+#include "metrics.h"
+
+// Per-plugin storage partitions
+//
+// Keys stay global so plugins can still share state, but every value is
+// owned by the partition of the plugin that last wrote it. A partition
+// hands out small values from size-class slabs carved out of 64 KB blocks,
+// counts key and value bytes against an optional quota, and is released as
+// a whole when its plugin unloads: the blocks are dropped and a generation
+// bump turns every index entry still pointing into them into a miss.
+//
+// Slots are typed (DATA_STRING, DATA_INT64, DATA_DOUBLE, DATA_BYTES). Numbers
+// are kept inline in the index so add, compare_and_swap and exchange never
+// format or allocate; every public call holds the storage lock, which makes
+// them atomic with respect to each other.
+
+#define STORAGE_BLOCK_SIZE (64 * 1024)
+#define STORAGE_SLAB_MIN 16
+#define STORAGE_SLAB_CLASSES 6 // 16, 32, 64, 128, 256, 512 bytes
+#define STORAGE_NUMBER_TEXT 32 // Slab value a number read as text is formatted into
+
+struct StorageQuota {
+    uint64_t maxBytes = 0; // 0 for unlimited
+    uint64_t maxKeys = 0;
+};
+
+class StoragePartition {
+public:
+    std::string name;
+    uint32_t generation = 1;
+    StorageQuota quota;
+
+    uint64_t bytes = 0;    // Key and value bytes in use
+    uint64_t keys = 0;
+    uint64_t reserved = 0; // Slab blocks plus large values
+    uint64_t rejected = 0; // Writes refused by the quota
+
+    ~StoragePartition() { release(); }
+
+    char* allocate(uint32_t size);
+    void free(char* ptr, uint32_t size);
+
+    // Frees everything at once, values handed out before are invalid after
+    void release();
+
+    static bool same_class(uint32_t a, uint32_t b);
+
+private:
+    struct FreeNode { FreeNode* next; };
+    struct LargeValue { LargeValue* prev; LargeValue* next; };
+
+    std::vector<char*> blocks;
+    char* cursor = nullptr;
+    char* end = nullptr;
+    FreeNode* freeLists[STORAGE_SLAB_CLASSES] = {};
+    LargeValue* large = nullptr;
+};
+
+class Storage {
+public:
+    // [STORAGE] entries: bytes=, keys= for the defaults, <plugin>=<bytes> and <plugin>.keys=<n> per plugin
+    void configure(const std::vector<std::string>& entries);
+
+    // Owned by the storage, valid for the whole run. name "" is the host's own
+    StoragePartition* partition(const std::string& name);
+
+    bool set(StoragePartition* owner, const char* key, const char* value);
+    bool set_value(StoragePartition* owner, const char* key, const DataValue& value);
+
+    // Valid until the key is written again. Numbers are formatted on the first
+    // get into a value kept with the slot, which add refreshes
+    const char* get(const char* key);
+    bool get_value(const char* key, DataValue& out);
+    bool has(const char* key);
+    bool remove(const char* key);
+
+    // Int64 and double slots only, a missing key starts at zero
+    bool add(StoragePartition* owner, const char* key, const DataValue& delta, DataValue& result);
+    bool exchange(StoragePartition* owner, const char* key, const DataValue& value, DataValue& previous);
+
+    // expected DATA_NONE matches a missing key, desired DATA_NONE deletes it
+    bool compare_and_swap(StoragePartition* owner, const char* key, const DataValue& expected, const DataValue& desired);
+
+    // Deletes the key ms from now, 0 clears its TTL. Writing with set or
+    // set_value clears it too. Returns false for missing keys
+    bool expire(const char* key, uint32_t ms);
+
+    // Removes keys whose TTL has run out, returns how many
+    size_t expire_due();
+
+    // Drops every key the partition owns
+    void release(StoragePartition* owner);
+
+    // One line per partition: name, bytes/quota, keys/quota, reserved, rejected
+    std::string usage() const;
+
+    // Bytes, keys and rejected writes per partition, for the metrics page
+    void metrics(std::vector<MetricSample>& out) const;
+
+    // While enabled, set and remove remember each key they touch once, in order
+    bool trackChanges = false;
+    std::vector<std::string> take_changes();
+
+private:
+    struct Slot {
+        StoragePartition* owner;
+        uint32_t generation;
+        uint32_t type;      // DATA_*
+        char* value;        // Strings and bytes, always NUL terminated; text of a number once read
+        uint32_t size;      // Value length without the terminator, 8 for numbers
+        union { int64_t i; double d; } number;
+        uint64_t expiresAt; // Storage clock ms, 0 for never
+    };
+
+    Slot* find(const char* key);
+    void sweep();
+    void changed(const char* key);
+    bool write(StoragePartition* owner, const char* key, const DataValue& value, bool keepExpiry);
+    bool erase(const char* key);
+    static uint32_t value_capacity(const Slot& slot);
+    static void format_number(Slot& slot);
+
+    mutable std::recursive_mutex lock;
+
+    StorageQuota defaults;
+    std::unordered_map<std::string, uint64_t> byteQuotas;
+    std::unordered_map<std::string, uint64_t> keyQuotas;
+    std::unordered_map<std::string, std::unique_ptr<StoragePartition>> partitions;
+    std::unordered_map<std::string, Slot> index;
+    size_t stale = 0; // Index entries left behind by released partitions
+
+    std::vector<std::string> changes;
+    std::unordered_set<std::string> changedKeys;
+
+    using Expiry = std::pair<uint64_t, std::string>;
+    std::priority_queue<Expiry, std::vector<Expiry>, std::greater<Expiry>> expiries;
+};
+
+// "64K", "8M", "1G" or plain bytes
+uint64_t parse_size(const std::string& text);
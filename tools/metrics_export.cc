@@ -0,0 +1,202 @@
+// Prints the runtime's metrics page in the Prometheus text format
+//
+//   metrics_export runtime.metrics                 print once
+//   metrics_export runtime.metrics out.prom 1000   rewrite out.prom every second,
+//                                                  for node_exporter's textfile collector
+//
+// The host never waits for readers: a copy taken while it was publishing is
+// thrown away and taken again.
+
+#include "../metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+    #define _WINSOCKAPI_
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+struct Snapshot {
+    struct Entry { std::string key; uint32_t type; double value; };
+    std::vector<Entry> entries;
+    uint64_t publishedNs = 0;
+};
+
+// ================= Page =================
+
+class PageView {
+public:
+    ~PageView() { close(); }
+
+    bool open(const char* path) {
+#ifdef _WIN32
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                           nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) { file = nullptr; return false; }
+        LARGE_INTEGER length;
+        GetFileSizeEx(file, &length);
+        size = (size_t)length.QuadPart;
+        if (size < sizeof(MetricsHeader)) { close(); return false; }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MetricsHeader)) { ::close(fd); return false; }
+        size = (size_t)st.st_size;
+        data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) data = nullptr;
+#endif
+        if (!data) { close(); return false; }
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (data) UnmapViewOfFile(data);
+        if (mapping) CloseHandle(mapping);
+        if (file) CloseHandle(file);
+        mapping = file = nullptr;
+#else
+        if (data) munmap(data, size);
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+    // Seqlock read: copy, then keep the copy only if no publish overlapped it
+    bool read(Snapshot& out) const {
+        const MetricsHeader* header = static_cast<const MetricsHeader*>(data);
+        const MetricsEntry* entries = reinterpret_cast<const MetricsEntry*>(header + 1);
+        if (header->magic != METRICS_MAGIC || header->version != METRICS_VERSION) return false;
+
+        size_t room = (size - sizeof(MetricsHeader)) / sizeof(MetricsEntry);
+        for (int attempt = 0; attempt < 1000; attempt++) {
+            uint64_t before = header->sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            uint32_t count = std::min<uint32_t>(header->count, (uint32_t)std::min<size_t>(room, header->capacity));
+            out.entries.resize(count);
+            for (uint32_t i = 0; i < count; i++) {
+                char key[METRICS_KEY_MAX];
+                memcpy(key, entries[i].key, sizeof(key));
+                key[METRICS_KEY_MAX - 1] = '\0';
+                uint64_t bits = entries[i].value.load(std::memory_order_relaxed);
+                out.entries[i].key = key;
+                out.entries[i].type = entries[i].type;
+                memcpy(&out.entries[i].value, &bits, sizeof(bits));
+            }
+            out.publishedNs = header->publishedNs;
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (header->sequence.load(std::memory_order_relaxed) == before) return true;
+        }
+        return false;
+    }
+
+private:
+    void* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = nullptr;
+    HANDLE mapping = nullptr;
+#endif
+};
+
+// ================= Prometheus text =================
+
+static std::string format(const Snapshot& snapshot) {
+    // Series of one metric are grouped under a single TYPE line
+    std::vector<std::string> names;
+    std::vector<std::vector<const Snapshot::Entry*>> groups;
+    std::vector<uint32_t> types;
+    for (const auto& e : snapshot.entries) {
+        std::string name = e.key.substr(0, e.key.find('{'));
+        size_t i = 0;
+        while (i < names.size() && names[i] != name) i++;
+        if (i == names.size()) {
+            names.push_back(name);
+            groups.emplace_back();
+            types.push_back(e.type);
+        }
+        groups[i].push_back(&e);
+    }
+
+    std::string out;
+    char value[64];
+    for (size_t i = 0; i < names.size(); i++) {
+        out += "# TYPE " + names[i] + (types[i] == METRIC_COUNTER ? " counter\n" : " gauge\n");
+        for (const Snapshot::Entry* e : groups[i]) {
+            snprintf(value, sizeof(value), " %.15g\n", e->value);
+            out += e->key + value;
+        }
+    }
+    return out;
+}
+
+// Written next to the target and renamed over it, scrapers never see half a file
+static bool write_atomically(const std::string& path, const std::string& text) {
+    std::string temporary = path + ".tmp";
+    FILE* f = fopen(temporary.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(text.data(), 1, text.size(), f) == text.size();
+    ok = fclose(f) == 0 && ok;
+#ifdef _WIN32
+    ok = ok && MoveFileExA(temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+    ok = ok && rename(temporary.c_str(), path.c_str()) == 0;
+#endif
+    return ok;
+}
+
+static bool scrape(const char* page, Snapshot& snapshot) {
+    // Mapped per scrape, a restarted runtime recreates the file
+    PageView view;
+    return view.open(page) && view.read(snapshot);
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2 && argc != 4) {
+        fprintf(stderr, "usage: %s <metrics file> [<out.prom> <interval ms>]\n", argv[0]);
+        return 2;
+    }
+
+    Snapshot snapshot;
+    if (argc == 2) {
+        if (!scrape(argv[1], snapshot)) {
+            fprintf(stderr, "No readable metrics page at %s\n", argv[1]);
+            return 1;
+        }
+        fputs(format(snapshot).c_str(), stdout);
+        return 0;
+    }
+
+    std::string out = argv[2];
+    auto interval = std::chrono::milliseconds(atoi(argv[3]) > 0 ? atoi(argv[3]) : 1000);
+    bool missing = false;
+    for (;;) {
+        if (scrape(argv[1], snapshot)) {
+            if (!write_atomically(out, format(snapshot))) fprintf(stderr, "Cannot write %s\n", out.c_str());
+            missing = false;
+        } else if (!missing) {
+            fprintf(stderr, "No readable metrics page at %s, waiting\n", argv[1]);
+            missing = true;
+        }
+        std::this_thread::sleep_for(interval);
+    }
+}
@@ -0,0 +1,272 @@
+// Loads N copies of bench/scale_plugin.cc into the runtime, for N in a list,
+// and prints how startup, frames, memory and unload grow with N
+//
+//   ./compile.sh bench
+//   scale_harness --counts 10,100,1000,5000 --duration 5s
+//
+// Every run gets a fresh directory with N copies of the plugin (scale_00001.so,
+// ...) and a plugins.ini listing them, and runs `runtime --until <duration>
+// --stats` there with stdin closed. The runtime's [Stats] lines give startup
+// (index probing and loading), frame work (mean, p99, max, sleep excluded) and
+// unload times; peak RSS comes from the exited process. --warm runs every N
+// twice and reports the second, with the plugin index already built.
+//
+// Options:
+//   --runtime <path>    runtime binary (./runtime)
+//   --plugin <path>     built scale plugin (plugins/scale_plugin.so)
+//   --dir <path>        scratch directory, emptied per run (scale_run)
+//   --counts <list>     plugin counts (10,100,1000,5000)
+//   --duration <d>      main loop time per run, as for --until (3s)
+//   --listeners <n>     SCALE_LISTENERS, handlers per plugin (4)
+//   --topics <n>        SCALE_TOPICS, shared topics; by default N / 8, so
+//                       listeners per topic stay constant as N grows
+//   --timers <n>        SCALE_TIMERS, repeating timers per plugin (1)
+//   --keys <n>          SCALE_KEYS, storage writes per plugin per tick (2)
+//   --work-us <n>       SCALE_WORK_US, busy time per handler call (0)
+//   --warm              report a second run per N
+//   --csv <file>        also write the results as CSV
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/resource.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+struct Options {
+    std::string runtime = "./runtime";
+    std::string plugin = "plugins/scale_plugin.so";
+    std::string dir = "scale_run";
+    std::vector<uint32_t> counts = {10, 100, 1000, 5000};
+    std::string duration = "3s";
+    std::string listeners = "4";
+    std::string topics;
+    std::string timers = "1";
+    std::string keys = "2";
+    std::string workUs = "0";
+    bool warm = false;
+    std::string csv;
+};
+
+struct Result {
+    uint32_t plugins = 0;
+    uint32_t loaded = 0;
+    double startupMs = -1;
+    uint64_t frames = 0;
+    double meanMs = -1, p99Ms = -1, maxMs = -1;
+    double unloadMs = -1;
+    double rssMb = -1;
+    double wallS = 0;
+    int status = 0;
+};
+
+// ================= Run =================
+
+static bool prepare(const Options& options, uint32_t count) {
+    std::error_code error;
+    fs::path plugins = fs::path(options.dir) / "plugins";
+    fs::remove_all(options.dir, error);
+    if (!fs::create_directories(plugins, error)) {
+        fprintf(stderr, "Cannot create %s\n", plugins.string().c_str());
+        return false;
+    }
+
+    // Copies, not links: the loader would hand back the same library for the same file
+    std::ofstream ini(fs::path(options.dir) / "plugins.ini");
+    ini << "[PLUGINS]\n";
+    for (uint32_t i = 1; i <= count; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "scale_%05u.so", i);
+        if (!fs::copy_file(options.plugin, plugins / name, error)) {
+            fprintf(stderr, "Cannot copy %s: %s\n", options.plugin.c_str(), error.message().c_str());
+            return false;
+        }
+        ini << "Scale" << i << "=" << name << "\n";
+    }
+    return true;
+}
+
+// "[Stats] key value key value ..." lines, wherever the logger put them on the line
+static void parse(const std::string& output, Result& result) {
+    std::istringstream lines(output);
+    std::string line;
+    while (std::getline(lines, line)) {
+        size_t at = line.find("[Stats] ");
+        if (at == std::string::npos) continue;
+
+        std::istringstream fields(line.substr(at + 8));
+        std::string key, value;
+        while (fields >> key >> value) {
+            if (key == "plugins") result.loaded = (uint32_t)std::stoul(value);
+            else if (key == "startup_ms") result.startupMs = std::stod(value);
+            else if (key == "frames") result.frames = std::stoull(value);
+            else if (key == "mean_ms") result.meanMs = std::stod(value);
+            else if (key == "p99_ms") result.p99Ms = std::stod(value);
+            else if (key == "max_ms") result.maxMs = std::stod(value);
+            else if (key == "unload_ms") result.unloadMs = std::stod(value);
+        }
+    }
+}
+
+#ifndef _WIN32
+static bool run(const Options& options, uint32_t count, Result& result) {
+    std::string runtime = fs::absolute(options.runtime).string();
+    std::string topics = options.topics.empty() ? std::to_string(std::max<uint32_t>(1, count / 8)) : options.topics;
+
+    int output[2];
+    if (pipe(output) != 0) return false;
+
+    auto begin = std::chrono::steady_clock::now();
+    pid_t child = fork();
+    if (child < 0) return false;
+    if (child == 0) {
+        if (chdir(options.dir.c_str()) != 0) _exit(127);
+        setenv("SCALE_LISTENERS", options.listeners.c_str(), 1);
+        setenv("SCALE_TOPICS", topics.c_str(), 1);
+        setenv("SCALE_TIMERS", options.timers.c_str(), 1);
+        setenv("SCALE_KEYS", options.keys.c_str(), 1);
+        setenv("SCALE_WORK_US", options.workUs.c_str(), 1);
+
+        int null = open("/dev/null", O_RDONLY);
+        dup2(null, STDIN_FILENO);
+        dup2(output[1], STDOUT_FILENO);
+        dup2(output[1], STDERR_FILENO);
+        close(output[0]);
+        close(output[1]);
+
+        execl(runtime.c_str(), runtime.c_str(), "--until", options.duration.c_str(), "--stats", (char*)nullptr);
+        _exit(127);
+    }
+
+    close(output[1]);
+    std::string text;
+    char buffer[65536];
+    ssize_t got;
+    while ((got = read(output[0], buffer, sizeof(buffer))) > 0) text.append(buffer, (size_t)got);
+    close(output[0]);
+
+    int status = 0;
+    struct rusage usage;
+    wait4(child, &status, 0, &usage);
+    result.wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    result.status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+#ifdef __APPLE__
+    result.rssMb = usage.ru_maxrss / (1024.0 * 1024.0); // Bytes
+#else
+    result.rssMb = usage.ru_maxrss / 1024.0;            // KiB
+#endif
+
+    parse(text, result);
+    if (result.status != 0 || result.startupMs < 0) {
+        fprintf(stderr, "Run with %u plugins exited with %d, last output:\n%s\n", count, result.status,
+                text.substr(text.size() > 2000 ? text.size() - 2000 : 0).c_str());
+    }
+    return true;
+}
+#endif
+
+// ================= Report =================
+
+static std::string cell(double value, const char* format) {
+    if (value < 0) return "n/a";
+    char text[32];
+    snprintf(text, sizeof(text), format, value);
+    return text;
+}
+
+static void print_row(const Result& r) {
+    printf("%8u %8u %12s %8llu %10s %10s %10s %10s %10s %8.1f\n", r.plugins, r.loaded,
+           cell(r.startupMs, "%.1f").c_str(), (unsigned long long)r.frames, cell(r.meanMs, "%.3f").c_str(),
+           cell(r.p99Ms, "%.3f").c_str(), cell(r.maxMs, "%.3f").c_str(), cell(r.unloadMs, "%.1f").c_str(),
+           cell(r.rssMb, "%.1f").c_str(), r.wallS);
+    fflush(stdout);
+}
+
+static std::vector<uint32_t> parse_counts(const std::string& list) {
+    std::vector<uint32_t> counts;
+    std::istringstream items(list);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        if (!item.empty()) counts.push_back((uint32_t)std::stoul(item));
+    }
+    return counts;
+}
+
+int main(int argc, char** argv) {
+#ifdef _WIN32
+    fprintf(stderr, "scale_harness needs fork/exec, run it on Linux or macOS\n");
+    return 1;
+#else
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--warm") options.warm = true;
+        else if (arg == "--runtime" && hasValue) options.runtime = argv[++i];
+        else if (arg == "--plugin" && hasValue) options.plugin = argv[++i];
+        else if (arg == "--dir" && hasValue) options.dir = argv[++i];
+        else if (arg == "--counts" && hasValue) options.counts = parse_counts(argv[++i]);
+        else if (arg == "--duration" && hasValue) options.duration = argv[++i];
+        else if (arg == "--listeners" && hasValue) options.listeners = argv[++i];
+        else if (arg == "--topics" && hasValue) options.topics = argv[++i];
+        else if (arg == "--timers" && hasValue) options.timers = argv[++i];
+        else if (arg == "--keys" && hasValue) options.keys = argv[++i];
+        else if (arg == "--work-us" && hasValue) options.workUs = argv[++i];
+        else if (arg == "--csv" && hasValue) options.csv = argv[++i];
+        else {
+            fprintf(stderr, "Unknown argument: %s (options are listed at the top of tools/scale_harness.cc)\n", arg.c_str());
+            return 2;
+        }
+    }
+    if (!fs::exists(options.runtime) || !fs::exists(options.plugin)) {
+        fprintf(stderr, "Need %s and %s, build them with ./compile.sh bench\n", options.runtime.c_str(), options.plugin.c_str());
+        return 1;
+    }
+
+    printf("%8s %8s %12s %8s %10s %10s %10s %10s %10s %8s\n", "plugins", "loaded", "startup_ms", "frames",
+           "mean_ms", "p99_ms", "max_ms", "unload_ms", "rss_mb", "wall_s");
+
+    std::vector<Result> results;
+    for (uint32_t count : options.counts) {
+        if (!prepare(options, count)) return 1;
+
+        Result result;
+        for (int pass = options.warm ? 2 : 1; pass > 0; pass--) {
+            result = Result();
+            result.plugins = count;
+            if (!run(options, count, result)) {
+                fprintf(stderr, "Cannot start %s\n", options.runtime.c_str());
+                return 1;
+            }
+        }
+        print_row(result);
+        results.push_back(result);
+    }
+
+    if (!options.csv.empty()) {
+        std::ofstream csv(options.csv);
+        csv << "plugins,loaded,startup_ms,frames,mean_ms,p99_ms,max_ms,unload_ms,rss_mb,wall_s\n";
+        for (const Result& r : results) {
+            csv << r.plugins << "," << r.loaded << "," << r.startupMs << "," << r.frames << "," << r.meanMs << ","
+                << r.p99Ms << "," << r.maxMs << "," << r.unloadMs << "," << r.rssMb << "," << r.wallS << "\n";
+        }
+    }
+
+    std::error_code error;
+    fs::remove_all(options.dir, error);
+    return 0;
+#endif
+}
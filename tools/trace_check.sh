@@ -0,0 +1,46 @@
+#!/bin/bash
+# Records a run of bench/trace_check.cc, replays it and checks that every
+# ping its timer sent was delivered exactly once in both runs. Events sent
+# from timers must be recorded as nested, since the timers fire again during
+# the replay.
+#
+#   ./compile.sh bench
+#   tools/trace_check.sh [runtime] [plugin]
+set -u
+
+RUNTIME=$(realpath "${1:-./runtime}")
+PLUGIN=$(realpath "${2:-plugins/trace_check.so}")
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+mkdir -p "$DIR/plugins"
+cp "$PLUGIN" "$DIR/plugins/trace_check.so"
+printf "[PLUGINS]\nCheck=trace_check.so\n" > "$DIR/plugins.ini"
+cd "$DIR" || exit 1
+
+counts() {
+    grep -o "\[TraceCheck\] sent [0-9]* received [0-9]*" "$1"
+}
+
+check() {
+    local name=$1 line sent received
+    line=$(counts "$name.log")
+    if [ -z "$line" ]; then
+        echo "$name: no [TraceCheck] line, output in $name.log:"
+        tail -20 "$name.log"
+        return 1
+    fi
+    sent=$(echo "$line" | awk '{print $3}')
+    received=$(echo "$line" | awk '{print $5}')
+    echo "$name: sent $sent received $received"
+    [ "$sent" -gt 0 ] && [ "$sent" = "$received" ]
+}
+
+"$RUNTIME" --virtual next --until 2s --record trace.bin < /dev/null > record.log 2>&1
+"$RUNTIME" --virtual next --replay trace.bin < /dev/null > replay.log 2>&1
+
+status=0
+check record || status=1
+check replay || status=1
+[ $status = 0 ] && echo "Trace check passed" || echo "Trace check FAILED"
+exit $status
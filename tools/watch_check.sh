@@ -0,0 +1,36 @@
+#!/bin/bash
+# Runs bench/watch_check.cc, whose watch callback unloads the plugin holding a
+# second watch on the same key, and checks that the second watch was skipped:
+# the runtime exits cleanly and nothing logs a call into the unloaded peer.
+#
+#   ./compile.sh bench
+#   tools/watch_check.sh [runtime] [plugin dir]
+set -u
+
+RUNTIME=$(realpath "${1:-./runtime}")
+PLUGINS=$(realpath "${2:-plugins}")
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+mkdir -p "$DIR/plugins"
+cp "$PLUGINS/watch_check.so" "$PLUGINS/watch_check_peer.so" "$DIR/plugins/"
+printf "[PLUGINS]\nCheck=watch_check.so\n" > "$DIR/plugins.ini"
+cd "$DIR" || exit 1
+
+"$RUNTIME" --until 500ms < /dev/null > run.log 2>&1
+code=$?
+
+status=0
+if [ $code != 0 ]; then
+    echo "runtime exited with $code"
+    status=1
+fi
+if ! grep -q "\[WatchCheck\] peer unloaded" run.log || grep -q "ERROR.*\[WatchCheck\]" run.log; then
+    status=1
+fi
+if [ $status != 0 ]; then
+    echo "output in run.log:"
+    tail -20 run.log
+fi
+[ $status = 0 ] && echo "Watch check passed" || echo "Watch check FAILED"
+exit $status
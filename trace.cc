@@ -0,0 +1,294 @@
+#include "trace.h"
+#include "ABI_compat_layer.h"
+#include "log.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+TraceRecorder* ACTIVE_TRACE = nullptr;
+
+// Thread buffers are handed to the flusher once they grow past this
+static const size_t TRACE_BUFFER_FLUSH_BYTES = 64 * 1024;
+static const auto TRACE_FLUSH_INTERVAL = std::chrono::milliseconds(50);
+
+static std::atomic<uint64_t> g_recorder_generation{0};
+
+static void put_varint(std::vector<uint8_t>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+static bool get_varint(const uint8_t*& p, const uint8_t* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        uint8_t b = *p++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+static void put_string(std::vector<uint8_t>& out, const char* s, size_t len) {
+    put_varint(out, len + 1);
+    out.insert(out.end(), s, s + len);
+    out.push_back('\0');
+}
+
+// ================= Recording =================
+
+TraceRecorder::~TraceRecorder() {
+    close();
+}
+
+bool TraceRecorder::open(const char* path) {
+    file = fopen(path, "wb");
+    if (!file) {
+        log_error(std::string("[Trace] Could not open trace file: ") + path);
+        return false;
+    }
+
+    uint32_t version = TRACE_VERSION;
+    fwrite(TRACE_MAGIC, 1, 4, file);
+    fwrite(&version, sizeof(version), 1, file);
+
+    generation = ++g_recorder_generation;
+    start = CLOCK.now();
+    running = true;
+    flusher = std::thread(&TraceRecorder::flush_loop, this);
+    return true;
+}
+
+void TraceRecorder::close() {
+    if (!running.exchange(false)) return;
+
+    wake.notify_one();
+    flusher.join();
+    flush_all();
+
+    fclose(file);
+    file = nullptr;
+}
+
+TraceRecorder::ThreadBuffer& TraceRecorder::local_buffer() {
+    struct Slot {
+        uint64_t generation = 0;
+        std::shared_ptr<ThreadBuffer> buffer;
+    };
+    thread_local Slot slot;
+
+    if (slot.generation != generation) {
+        slot.buffer = std::make_shared<ThreadBuffer>();
+        slot.buffer->bytes.reserve(TRACE_BUFFER_FLUSH_BYTES);
+        slot.generation = generation;
+
+        std::lock_guard<std::mutex> guard(buffersLock);
+        buffers.push_back(slot.buffer);
+    }
+    return *slot.buffer;
+}
+
+uint32_t TraceRecorder::intern(ThreadBuffer& tb, const char* eventName) {
+    auto cached = tb.nameCache.find(std::string_view(eventName));
+    if (cached != tb.nameCache.end()) return cached->second;
+
+    std::lock_guard<std::mutex> guard(namesLock);
+    auto it = names.find(eventName);
+    if (it == names.end()) {
+        it = names.emplace(eventName, (uint32_t)names.size()).first;
+        pendingNames.push_back(&it->first);
+    }
+
+    // Node based map, the key storage stays put for the cache view
+    tb.nameCache.emplace(std::string_view(it->first), it->second);
+    return it->second;
+}
+
+void TraceRecorder::record(const char* eventName, const char* payload, bool nested) {
+    if (!running.load(std::memory_order_relaxed)) return;
+
+    uint64_t ts = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        CLOCK.now() - start).count();
+
+    ThreadBuffer& tb = local_buffer();
+    uint32_t id = intern(tb, eventName);
+    if (!payload) payload = "";
+
+    bool full;
+    {
+        std::lock_guard<std::mutex> guard(tb.lock);
+        tb.bytes.push_back(TRACE_REC_EVENT);
+        put_varint(tb.bytes, ts);
+        put_varint(tb.bytes, nested ? TRACE_FLAG_NESTED : 0);
+        put_varint(tb.bytes, id);
+        put_string(tb.bytes, payload, strlen(payload));
+        full = tb.bytes.size() >= TRACE_BUFFER_FLUSH_BYTES;
+    }
+    recordedCount.fetch_add(1, std::memory_order_relaxed);
+
+    if (full) wake.notify_one();
+}
+
+void TraceRecorder::flush_loop() {
+    while (running) {
+        {
+            std::unique_lock<std::mutex> guard(wakeLock);
+            wake.wait_for(guard, TRACE_FLUSH_INTERVAL);
+        }
+        flush_all();
+    }
+}
+
+void TraceRecorder::flush_all() {
+    std::vector<std::shared_ptr<ThreadBuffer>> snapshot;
+    {
+        std::lock_guard<std::mutex> guard(buffersLock);
+        snapshot = buffers;
+    }
+
+    // Take the event bytes before writing names: every taken event interned
+    // its name before it was buffered, so its name record is already pending
+    std::vector<std::vector<uint8_t>> taken(snapshot.size());
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        std::lock_guard<std::mutex> guard(snapshot[i]->lock);
+        if (snapshot[i]->bytes.empty()) continue;
+        taken[i].swap(snapshot[i]->bytes);
+        snapshot[i]->bytes.reserve(TRACE_BUFFER_FLUSH_BYTES);
+    }
+
+    std::vector<uint8_t> out;
+    {
+        std::lock_guard<std::mutex> guard(namesLock);
+        for (const std::string* name : pendingNames) {
+            out.push_back(TRACE_REC_NAME);
+            put_varint(out, names[*name]);
+            put_string(out, name->c_str(), name->size());
+        }
+        pendingNames.clear();
+    }
+    if (!out.empty()) fwrite(out.data(), 1, out.size(), file);
+
+    for (auto& bytes : taken) {
+        if (!bytes.empty()) fwrite(bytes.data(), 1, bytes.size(), file);
+    }
+    fflush(file);
+}
+
+// ================= Replay =================
+
+bool TraceReplayer::open(const char* path) {
+    close();
+
+    MappedFile* mf = new MappedFile();
+    if (!platform_map_file(path, mf)) {
+        log_error(std::string("[Trace] Could not map trace file: ") + path);
+        delete mf;
+        return false;
+    }
+    mapping = mf;
+
+    const uint8_t* p = (const uint8_t*)mf->data;
+    const uint8_t* end = p + mf->size;
+
+    uint32_t version = 0;
+    if (mf->size < 8 || memcmp(p, TRACE_MAGIC, 4) != 0) {
+        log_error(std::string("[Trace] Not a trace file: ") + path);
+        close();
+        return false;
+    }
+    memcpy(&version, p + 4, sizeof(version));
+    if (version != TRACE_VERSION) {
+        log_error("[Trace] Unsupported trace version " + std::to_string(version));
+        close();
+        return false;
+    }
+    p += 8;
+
+    // Reads a terminated string in place, false if it runs off the mapping
+    auto read_string = [&](const char*& out) {
+        uint64_t len;
+        if (!get_varint(p, end, len) || len == 0 || len > (uint64_t)(end - p)) return false;
+        if (p[len - 1] != '\0') return false;
+        out = (const char*)p;
+        p += len;
+        return true;
+    };
+
+    while (p < end) {
+        uint8_t tag = *p++;
+        if (tag == TRACE_REC_NAME) {
+            uint64_t id;
+            const char* name;
+            if (!get_varint(p, end, id) || !read_string(name)) break;
+            if (id >= nameTable.size()) nameTable.resize(id + 1, nullptr);
+            nameTable[id] = name;
+        } else if (tag == TRACE_REC_EVENT) {
+            uint64_t ts, flags, id;
+            const char* payload;
+            if (!get_varint(p, end, ts) || !get_varint(p, end, flags) ||
+                !get_varint(p, end, id) || !read_string(payload)) break;
+            if (id >= nameTable.size() || !nameTable[id]) break;
+            if ((flags & TRACE_FLAG_NESTED) && !includeNested) continue;
+            ordered.push_back({ts, (uint32_t)flags, nameTable[id], payload});
+        } else {
+            break;
+        }
+    }
+
+    if (p < end) {
+        log_warn("[Trace] Trace truncated or corrupt, replaying " +
+                 std::to_string(ordered.size()) + " events");
+    }
+
+    // Buffers from different threads are flushed interleaved
+    std::stable_sort(ordered.begin(), ordered.end(),
+        [](const TraceEvent& a, const TraceEvent& b) { return a.timestamp_ns < b.timestamp_ns; });
+    return true;
+}
+
+void TraceReplayer::close() {
+    if (mapping) {
+        MappedFile* mf = (MappedFile*)mapping;
+        platform_unmap_file(mf);
+        delete mf;
+        mapping = nullptr;
+    }
+    nameTable.clear();
+    ordered.clear();
+    cursor = 0;
+}
+
+size_t TraceReplayer::replay_fast(const std::function<void(const char*, const char*)>& send) {
+    size_t sent = 0;
+    for (; cursor < ordered.size(); cursor++, sent++) {
+        send(ordered[cursor].name, ordered[cursor].payload);
+    }
+    return sent;
+}
+
+void TraceReplayer::begin() {
+    cursor = 0;
+    firstTimestamp = ordered.empty() ? 0 : ordered.front().timestamp_ns;
+    replayStart = CLOCK.now();
+}
+
+bool TraceReplayer::next_due(Clock::time_point& out) const {
+    if (finished()) return false;
+    out = replayStart + std::chrono::nanoseconds(ordered[cursor].timestamp_ns - firstTimestamp);
+    return true;
+}
+
+size_t TraceReplayer::replay_due(const std::function<void(const char*, const char*)>& send) {
+    uint64_t elapsed = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        CLOCK.now() - replayStart).count() + firstTimestamp;
+
+    size_t sent = 0;
+    while (cursor < ordered.size() && ordered[cursor].timestamp_ns <= elapsed) {
+        send(ordered[cursor].name, ordered[cursor].payload);
+        cursor++;
+        sent++;
+    }
+    return sent;
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "clock.h"
+
+// Binary event trace
+//
+// File layout: "EVTR" magic, u32 format version, then a stream of records.
+// All integers after the header are LEB128 varints.
+//   TRACE_REC_NAME:  id, length, bytes           (interned event name)
+//   TRACE_REC_EVENT: timestamp ns, flags, name id, payload length, bytes
+// Strings are stored with their terminator so replay can point straight into
+// the mapping. A name record is always written before the first event using it.
+
+#define TRACE_MAGIC "EVTR"
+#define TRACE_VERSION 1
+
+#define TRACE_REC_NAME 1
+#define TRACE_REC_EVENT 2
+
+#define TRACE_FLAG_NESTED 1 // Sent from inside another event handler
+
+class TraceRecorder {
+public:
+    TraceRecorder() = default;
+    ~TraceRecorder();
+
+    bool open(const char* path);
+    void close();
+
+    // Called from EventBus::send_event, any thread
+    void record(const char* eventName, const char* payload, bool nested);
+
+    uint64_t recorded() const { return recordedCount.load(std::memory_order_relaxed); }
+
+private:
+    struct ThreadBuffer {
+        std::mutex lock;
+        std::vector<uint8_t> bytes;
+        std::unordered_map<std::string_view, uint32_t> nameCache;
+    };
+
+    uint32_t intern(ThreadBuffer& tb, const char* eventName);
+    ThreadBuffer& local_buffer();
+    void flush_loop();
+    void flush_all();
+
+    FILE* file = nullptr;
+    Clock::time_point start;
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> recordedCount{0};
+    uint64_t generation = 0;
+
+    std::mutex namesLock;
+    std::unordered_map<std::string, uint32_t> names;
+    std::vector<const std::string*> pendingNames; // Interned but not yet written
+
+    std::mutex buffersLock;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+    std::mutex wakeLock;
+    std::condition_variable wake;
+    std::thread flusher;
+};
+
+struct TraceEvent {
+    uint64_t timestamp_ns;
+    uint32_t flags;
+    const char* name;     // Points into the mapped trace
+    const char* payload;  // Points into the mapped trace
+};
+
+class TraceReplayer {
+public:
+    ~TraceReplayer() { close(); }
+
+    bool open(const char* path);
+    void close();
+
+    // Events in timestamp order. Nested events are skipped unless requested,
+    // the plugins regenerate them when the outer event is replayed
+    const std::vector<TraceEvent>& events() const { return ordered; }
+
+    // Inject every event back to back, returns the number sent
+    size_t replay_fast(const std::function<void(const char*, const char*)>& send);
+
+    // Inject the events whose offset from the first event has elapsed since begin()
+    void begin();
+    size_t replay_due(const std::function<void(const char*, const char*)>& send);
+    bool finished() const { return cursor >= ordered.size(); }
+
+    // When the next event is due, for the virtual clock's deadline jumps. False once finished
+    bool next_due(Clock::time_point& out) const;
+
+    bool includeNested = false;
+
+private:
+    void* mapping = nullptr; // MappedFile*
+    std::vector<const char*> nameTable;
+    std::vector<TraceEvent> ordered;
+    size_t cursor = 0;
+    uint64_t firstTimestamp = 0;
+    Clock::time_point replayStart;
+};
+
+// Set while recording, checked on every dispatch
+extern TraceRecorder* ACTIVE_TRACE;